@@ -0,0 +1,81 @@
+-- async.lua: check the option `async` and oluacle.run on the stub of OCI.
+--
+--   make -f Makefile.lin async
+--   ./oluacle-bench async.lua
+--
+-- No database is used: with `delay=N` in the SQL, OCIStmtExecute of
+-- ocistub.c returns OCI_STILL_EXECUTING N times in the non-blocking mode
+-- before it succeeds. Queries of different delays are run by oluacle.run
+-- on connections made with { async=true }. They have to give all their
+-- rows, and the one of the shortest delay has to end first even though
+-- it started last. An error raises out of oluacle.run after the others end.
+
+assert( oluacle and oluacle.allocations ,
+        "run with oluacle-bench (make -f Makefile.lin async)" )
+
+local function sql(rows,delay)
+    return ("select * from stub -- rows=%d cols=3 delay=%d"):format(rows,delay)
+end
+
+local log = {}
+
+local function query(name,conn,rows,delay)
+    return function()
+        local n = 0
+        log[#log+1] = "start " .. name
+        for rs in conn:exec(sql(rows,delay)) do
+            n = n + 1
+        end
+        log[#log+1] = "end " .. name
+        return n
+    end
+end
+
+local function check(expected)
+    assert( table.concat(log,",") == table.concat(expected,",") ,
+            "order: " .. table.concat(log,",") )
+    log = {}
+end
+
+local function connect(async)
+    return oluacle.new('stub','stub','',{ async=async , fetch_size=7 })
+end
+
+-- async: the calls interleave, and the shortest delay ends first
+local a , b , c = connect(true) , connect(true) , connect(true)
+local na , nb , nc = oluacle.run(
+    query("a",a,30,6) ,
+    query("b",b,20,4) ,
+    query("c",c,10,2) )
+assert( na == 30 and nb == 20 and nc == 10 , "rows: " .. na .. "," .. nb .. "," .. nc )
+check{ "start a" , "start b" , "start c" , "end c" , "end b" , "end a" }
+
+-- the statements cached by the first run are executed again
+na , nb , nc = oluacle.run(
+    query("a",a,30,6) ,
+    query("b",b,20,4) ,
+    query("c",c,10,2) )
+assert( na == 30 and nb == 20 and nc == 10 )
+check{ "start a" , "start b" , "start c" , "end c" , "end b" , "end a" }
+
+-- out of a coroutine, the call is polled until it completes
+assert( query("a",a,5,3)() == 5 )
+check{ "start a" , "end a" }
+
+-- without async, each function runs to the end before the next one
+local s1 , s2 = connect(false) , connect(false)
+na , nb = oluacle.run( query("a",s1,30,6) , query("b",s2,10,2) )
+assert( na == 30 and nb == 10 )
+check{ "start a" , "end a" , "start b" , "end b" }
+
+-- an error is raised after the others end
+local ok , message = pcall( oluacle.run ,
+    function() error("failed") end ,
+    query("b",b,20,4) )
+assert( not ok and tostring(message):find("failed") , tostring(message) )
+check{ "start b" , "end b" }
+
+for _,conn in ipairs{ a , b , c , s1 , s2 } do
+    conn:disconnect()
+end
+print("async.lua: ok")
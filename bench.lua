@@ -0,0 +1,113 @@
+-- bench.lua: measure the cost of oluacle itself with the stub of OCI.
+--
+--   make -f Makefile.lin bench
+--   ./oluacle-bench bench.lua [ROWS] [COLUMNS] [TYPES]
+--
+-- No database is used: ocistub.c makes the result sets from the words
+-- `rows=N cols=N types=...` in the SQL (see the comment of ocistub.c for
+-- TYPES). For each case, the rows per second, the time per cell and the
+-- blocks and bytes allocated by the Lua state per row are printed.
+
+assert( oluacle and oluacle.allocations ,
+        "run with oluacle-bench (make -f Makefile.lin bench)" )
+
+local nrows = tonumber(arg and arg[1]) or 100000
+local ncols = tonumber(arg and arg[2]) or 10
+local types = arg and arg[3] or 'insdt'
+
+local select_sql = ("select * from stub -- rows=%d cols=%d types=%s"):format(
+                        nrows , ncols , types )
+local select1_sql = ("select * from stub -- rows=1 cols=%d types=%s"):format(
+                        ncols , types )
+
+local placeholders = {}
+local values = {}
+for i=1,ncols do
+    local t = types:sub((i-1) % #types + 1,(i-1) % #types + 1)
+    placeholders[i] = ":" .. i
+    if t == 'n' then
+        values[i] = i + 0.5
+    elseif t == 's' or t == 'd' or t == 't' or t == 'z' or t == 'c' then
+        values[i] = "value" .. i
+    else
+        values[i] = i
+    end
+end
+local insert_sql = "insert into stub values(" ..
+                    table.concat(placeholders,",") .. ")"
+
+local function measure(name,rows,func)
+    collectgarbage("collect")
+    local count,bytes = oluacle.allocations()
+    local clock = os.clock()
+    func()
+    clock = os.clock() - clock
+    local count2,bytes2 = oluacle.allocations()
+    print(("%-14s %12.0f %10.1f %10.2f %12.1f"):format(
+        name , rows / clock , clock * 1e9 / (rows*ncols) ,
+        (count2-count) / rows , (bytes2-bytes) / rows ))
+end
+
+local function fetch(conn,name,option)
+    local stmt = conn:prepare(select_sql)
+    for key,value in pairs(option) do
+        stmt[key] = value
+    end
+    measure(name,nrows,function()
+        for rs in stmt:execute() do
+        end
+    end)
+end
+
+local conn = oluacle.new('stub','stub','',{ fetch_size=500 })
+print(("%d rows x %d columns, types=%s"):format(nrows,ncols,types))
+print(("%-14s %12s %10s %10s %12s"):format(
+    "case" , "rows/s" , "ns/cell" , "allocs/row" , "bytes/row" ))
+
+-- exec: one row a call, through the statement cache
+local nexec = math.max(1,math.floor(nrows / 10))
+measure("exec",nexec,function()
+    for i=1,nexec do
+        for rs in conn:exec(select1_sql) do
+        end
+    end
+end)
+
+-- fetch: each row mode and fetchcolumns
+fetch(conn,"table"      , { mode="table" })
+fetch(conn,"table,reuse", { mode="table" , reuse=true })
+fetch(conn,"array"      , { mode="array" })
+fetch(conn,"array,reuse", { mode="array" , reuse=true })
+fetch(conn,"lazy"       , { mode="lazy" })
+do
+    local stmt = conn:prepare(select_sql)
+    measure("fetchcolumns",nrows,function()
+        stmt:execute()
+        stmt:fetchcolumns()
+    end)
+end
+
+-- binds: STMT:bind and STMT:execute of a DML for each row
+do
+    local stmt = conn:prepare(insert_sql)
+    local unpack = table.unpack or unpack
+    measure("binds",nexec,function()
+        for i=1,nexec do
+            stmt:bind(unpack(values))
+            stmt:execute()
+        end
+    end)
+end
+
+-- dml: CONN:execmany with array binds
+do
+    local rows = {}
+    for i=1,nrows do
+        rows[i] = values
+    end
+    measure("dml",nrows,function()
+        conn:execmany(insert_sql,rows)
+    end)
+end
+
+conn:disconnect()
@@ -0,0 +1,55 @@
+-- benchrows.lua: compare the cost of the row modes of CONN:exec.
+--
+--   oluacle benchrows.lua USER PASSWORD [DBNAME] [ROWS] [COLUMNS]
+--
+-- For each mode, all rows are fetched with the garbage collector stopped
+-- and the memory allocated by Lua per row is printed.
+
+if not oluacle then
+    oluacle = require 'oluacle'
+end
+
+local user   = arg and arg[1] or 'HR'
+local passwd = arg and arg[2] or 'HR'
+local dbname = arg and arg[3] or ''
+local nrows  = tonumber(arg and arg[4]) or 100000
+local ncols  = tonumber(arg and arg[5]) or 10
+
+local columns = {}
+for i=1,ncols do
+    columns[i] = ("level+%d as C%d"):format(i,i)
+end
+local sql = "select " .. table.concat(columns,",") ..
+            " from dual connect by level <= :n"
+
+local function run(conn,name,option)
+    local stmt = conn:prepare(sql)
+    for key,value in pairs(option) do
+        stmt[key] = value
+    end
+    stmt:bind(nrows)
+
+    collectgarbage("collect")
+    collectgarbage("stop")
+    local kbytes = collectgarbage("count")
+    local clock = os.clock()
+    local sum = 0
+    for rs in stmt:execute() do
+        sum = sum + rs[1]
+    end
+    clock = os.clock() - clock
+    kbytes = collectgarbage("count") - kbytes
+    collectgarbage("restart")
+
+    print(("%-12s %10.3f s %12.1f bytes/row"):format(
+        name , clock , kbytes * 1024 / nrows ))
+end
+
+local conn = oluacle.new(user,passwd,dbname,{ fetch_size=500 })
+print(("%d rows x %d columns"):format(nrows,ncols))
+run(conn,"table"      , { mode="table" })
+run(conn,"table,reuse", { mode="table" , reuse=true })
+run(conn,"array"      , { mode="array" })
+run(conn,"array,reuse", { mode="array" , reuse=true })
+run(conn,"lazy"       , { mode="lazy" })
+conn:disconnect()
@@ -0,0 +1,96 @@
+-- benchwide.lua: measure the cost per cell of a wide result set.
+--
+--   make -f Makefile.lin benchwide
+--   ./oluacle-bench benchwide.lua [ROWS] [COLUMNS] [TYPES] [REPEAT]
+--
+-- As bench.lua, it runs on the stub of OCI (ocistub.c), so the numbers
+-- can be reproduced on any machine and compared between builds. Each case
+-- fetches a narrow result (10 columns) and a wide one (200 columns by
+-- default) of the same number of cells, and prints the ns per cell of
+-- both and their ratio. With the define arrays indexed by the column
+-- number, the cost of a cell does not grow with the width: the ratio
+-- stays near 1. A walk over the columns per cell (as the list of define
+-- buffers did, and row[n] of the lazy rows) makes it grow with COLUMNS.
+--
+-- A single run swings by 30% or more, so each result is measured REPEAT
+-- times (5 by default), narrow and wide in turn, and the minimum is kept.
+-- The script fails when a ratio exceeds MAXRATIO.
+
+assert( oluacle and oluacle.allocations ,
+        "run with oluacle-bench (make -f Makefile.lin benchwide)" )
+
+local ncells = (tonumber(arg and arg[1]) or 5000) * 200
+local ncols  = tonumber(arg and arg[2]) or 200
+local types  = arg and arg[3] or 'is'
+local repeat_ = tonumber(arg and arg[4]) or 5
+local narrow = 10
+
+-- the walk over the columns made it about COLUMNS/2 for 200 columns
+local MAXRATIO = 1.5
+
+local function sql(cols)
+    return ("select * from stub -- rows=%d cols=%d types=%s"):format(
+                math.floor(ncells / cols) , cols , types )
+end
+
+-- ns per cell of func(stmt,cols) over a result of `cols` columns
+local function measure(cols,option,func)
+    local conn = oluacle.new('stub','stub','',{ fetch_size=200 })
+    local stmt = conn:prepare(sql(cols))
+    for key,value in pairs(option) do
+        stmt[key] = value
+    end
+    collectgarbage("collect")
+    local clock = os.clock()
+    func(stmt,cols)
+    clock = os.clock() - clock
+    conn:disconnect()
+    return clock * 1e9 / (math.floor(ncells / cols) * cols)
+end
+
+local function loop(stmt)
+    for rs in stmt:execute() do
+    end
+end
+
+-- lazy rows read every column: row[n] is where the width shows
+local function loopcells(stmt,cols)
+    for rs in stmt:execute() do
+        for c=1,cols do
+            local v = rs[c]
+        end
+    end
+end
+
+local function columns(stmt)
+    stmt:execute()
+    stmt:fetchcolumns()
+end
+
+local failed = {}
+
+local function case(name,option,func)
+    local n , w = math.huge , math.huge
+    for i=1,repeat_ do
+        n = math.min( n , measure(narrow,option,func) )
+        w = math.min( w , measure(ncols,option,func) )
+    end
+    print(("%-14s %12.1f %12.1f %8.2f"):format(name , n , w , w / n ))
+    if w / n > MAXRATIO then
+        failed[#failed+1] = ("%s (%.2f)"):format(name , w / n )
+    end
+end
+
+print(("%d cells, %d vs %d columns, types=%s, minimum of %d"):format(
+    ncells , narrow , ncols , types , repeat_ ))
+print(("%-14s %12s %12s %8s"):format(
+    "case" , ("ns/cell(%d)"):format(narrow) , ("ns/cell(%d)"):format(ncols) , "ratio" ))
+case("table"       , { mode="table" } , loop )
+case("table,reuse" , { mode="table" , reuse=true } , loop )
+case("array"       , { mode="array" } , loop )
+case("lazy"        , { mode="lazy" } , loopcells )
+case("fetchcolumns", {} , columns )
+
+assert( #failed == 0 ,
+        ("ns/cell grows with the columns (ratio > %.1f): %s"):format(
+            MAXRATIO , table.concat(failed,", ") ) )
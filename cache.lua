@@ -0,0 +1,75 @@
+-- cache.lua: check that the cursors drained go back to the statement cache.
+--
+--   make -f Makefile.lin cache
+--   ./oluacle-bench cache.lua
+--
+-- No database is used: the queries run on the stub of OCI (ocistub.c).
+-- The same SQL is executed twice on a connection, and its rows read to
+-- the end by the iterator or by STMT:fetchcolumns. The statement has to be
+-- released once drained, so that the second exec finds it in the cache:
+-- the counter `prepares` of CONN:stats stays 1.
+
+assert( oluacle and oluacle.allocations ,
+        "run with oluacle-bench (make -f Makefile.lin cache)" )
+
+local sql = "select * from stub -- rows=25 cols=3"
+
+local function loop(conn)
+    local n = 0
+    for rs in conn:exec(sql) do
+        n = n + 1
+    end
+    return n
+end
+
+local function columns(conn)
+    local _ , stmt = conn:exec(sql)
+    local result , n = stmt:fetchcolumns()
+    assert( #result == 3 and #result[1] == n )
+    return n
+end
+
+local function limited(conn)
+    local _ , stmt = conn:exec(sql)
+    local total = 0
+    repeat
+        local result , n = stmt:fetchcolumns(10)
+        total = total + (n or 0)
+    until not result or n < 10
+    return total
+end
+
+local function check(name,func,stmtcache,prepares)
+    local conn = oluacle.new('stub','stub','',{ fetch_size=7 , stmtcache=stmtcache })
+    assert( func(conn) == 25 and func(conn) == 25 , name .. ": rows" )
+    local stats = conn:stats()
+    assert( stats.prepares == prepares ,
+            ("%s: prepares=%d, expected %d"):format(name,stats.prepares,prepares) )
+    conn:disconnect()
+end
+
+check( "exec"                  , loop    , nil , 1 )
+check( "fetchcolumns"          , columns , nil , 1 )
+check( "fetchcolumns(limit)"   , limited , nil , 1 )
+-- without the cache, each exec prepares and the drained ones are freed
+check( "fetchcolumns,nocache"  , columns , 0   , 2 )
+
+-- the options of STMT:execute are not kept by the cached statement
+check( "execute{options}" , function(conn)
+    local _ , stmt = conn:exec(sql)
+    local n = 0
+    for rs in stmt:execute{ mode="array" } do
+        assert( rs.C1 == nil , "execute{mode='array'}: a row by name" )
+    end
+    for rs in conn:exec(sql) do
+        assert( rs.C1 ~= nil , "exec: the mode of the last execute{} is kept" )
+        n = n + 1
+    end
+    return n
+end , nil , 1 )
+
+-- CONN:page runs its own statement again
+check( "page" , function(conn)
+    return #conn:page(sql,{},0,10) + #conn:page(sql,{},10,15)
+end , nil , 1 )
+print("cache.lua: ok")
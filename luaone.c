@@ -11,6 +11,12 @@
 #include <dirent.h>
 
 int olua_connect( lua_State *lua );
+int olua_pool( lua_State *lua );
+int olua_run( lua_State *lua );
+int olua_environ( lua_State *lua );
+int olua_stats( lua_State *lua );
+int olua_out( lua_State *lua );
+int olua_inout( lua_State *lua );
 
 int luaone_chdir(lua_State *lua)
 {
@@ -93,6 +99,37 @@ const char *cmdloader(lua_State *lua,void *data,size_t *size)
     return buffer;
 }
 
+#ifdef OLUA_BENCH
+/* allocator of the Lua state for bench.lua, which counts the blocks
+ * (and the growth of blocks) allocated through it. */
+static unsigned long bench_count;
+static unsigned long bench_bytes;
+
+static void *bench_alloc(void *ud,void *ptr,size_t osize,size_t nsize)
+{
+    if( nsize == 0 ){
+        free(ptr);
+        return NULL;
+    }
+    if( ptr == NULL ){
+        bench_count++;
+        bench_bytes += nsize;
+    }else if( nsize > osize ){
+        bench_count++;
+        bench_bytes += nsize - osize;
+    }
+    return realloc(ptr,nsize);
+}
+
+/* COUNT,BYTES = oluacle.allocations() */
+int luaone_allocations(lua_State *lua)
+{
+    lua_pushnumber(lua,(lua_Number)bench_count);
+    lua_pushnumber(lua,(lua_Number)bench_bytes);
+    return 2;
+}
+#endif
+
 static struct luaone_s {
     const char *name;
     int (*func)(lua_State *lua);
@@ -100,6 +137,15 @@ static struct luaone_s {
     { "chdir" , luaone_chdir } ,
     { "dir"   , luaone_opendir },
     { "new"   , olua_connect },
+    { "pool"  , olua_pool },
+    { "run"   , olua_run },
+    { "environ" , olua_environ },
+    { "stats" , olua_stats },
+    { "out"   , olua_out },
+    { "inout" , olua_inout },
+#ifdef OLUA_BENCH
+    { "allocations" , luaone_allocations },
+#endif
     { NULL    , NULL } ,
 };
 
@@ -157,7 +203,11 @@ int main(int argc, char **argv)
         return -1;
     }
 
+#ifdef OLUA_BENCH
+    lua = lua_newstate(bench_alloc,NULL);
+#else
     lua = luaL_newstate();
+#endif
     luaL_openlibs(lua);
 
     lua_newtable(lua);
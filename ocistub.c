@@ -0,0 +1,1132 @@
+/* ocistub.c: a stub of the OCI library for `make -f Makefile.lin bench`.
+ *
+ * It implements the OCI calls which olua.c uses, without a server.
+ * Logon always succeeds, and a SELECT returns a synthetic result set
+ * described by `key=value` words in the SQL text (usually in a comment):
+ *
+ *   select * from stub -- rows=10000 cols=20 types=insdtc nulls=7
+ *
+ *   rows   number of rows (default 1000)
+ *   cols   number of columns C1,C2... (default 10)
+ *   types  column types, repeated over the columns (default "i")
+ *            i: NUMBER(10)  n: NUMBER  s: VARCHAR2(size)  d: DATE
+ *            t: TIMESTAMP   z: TIMESTAMP WITH TIME ZONE   c: CLOB
+ *   size   length of the VARCHAR2 columns (default 20)
+ *   nulls  every N-th cell is NULL (default 0: none)
+ *   delay  in the non-blocking mode, OCIStmtExecute returns
+ *          OCI_STILL_EXECUTING N times before it succeeds
+ *   results  a PL/SQL block returns N implicit results, each of them
+ *          the result set described by the other words
+ *
+ * INSERT, UPDATE, DELETE and MERGE process `iters` rows. The bind values
+ * are not read, so the cost measured is the one of oluacle itself, and
+ * REF CURSOR out-binds are not opened. Out-binds of OCIBindDynamic get a
+ * row per iteration: DML returns 1,2,3... over the executions of the
+ * statement, and PL/SQL returns the IN value (or the next number).
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <oci.h>
+
+#define STUB_ROWS 1000
+#define STUB_COLS 10
+#define STUB_SIZE 20
+#define STUB_TYPES_MAX 64
+#define STUB_DIRPATH_ROWS 100
+
+struct stub_column {
+    char letter;       /* the letter in `types` */
+    ub2 type;          /* SQLT_xxx described */
+    ub2 size;
+    sb2 precision;
+    sb1 scale;
+    char name[16];
+
+    /* OCIDefineByPos */
+    char *valuep;
+    sb4 value_sz;
+    ub2 dty;
+    sb2 *indp;
+    ub2 *rlenp;
+};
+
+/* one structure for all handles and descriptors */
+struct stub {
+    ub4 type;                  /* OCI_HTYPE_xxx or OCI_DTYPE_xxx */
+    struct stub *parent;       /* column array and stream: the context */
+
+    /* error */
+    char message[256];
+    sb4 code;
+
+    /* statement */
+    ub2 stmt_type;
+    ub4 rows, nulls, delay, waits, bind_count;
+    ub4 position, fetched, row_count;
+    ub4 ncols;
+    struct stub_column *columns;
+    struct stub *params;       /* statement and direct path context */
+    char *text;                /* PL/SQL: the words for implicit results */
+    struct stub **results;     /* implicit results returned */
+    ub4 nresults, next_result;
+
+    /* parameter */
+    struct stub_column *column;
+
+    /* bind of OCI_DATA_AT_EXEC (statement: the list, and the sequence) */
+    struct stub *binds;
+    ub4 sequence;
+    ub2 dty;
+    sb4 value_sz;
+    dvoid *ictxp, *octxp;
+    OCICallbackInBind icbfp;
+    OCICallbackOutBind ocbfp;
+
+    /* service context and server */
+    struct stub *server;
+    struct stub *pool;
+    int nonblocking;
+
+    /* session pool */
+    char name[16];
+    ub4 open, busy;
+
+    /* datetime */
+    sb2 year;
+    ub1 month, day, hour, min, sec;
+    ub4 fsec;
+    sb1 tzh, tzm;
+
+    /* lob */
+    char *data;
+    size_t len;
+
+    /* direct path context */
+    ub4 num_rows;
+};
+
+static struct stub *stub_new(ub4 type)
+{
+    struct stub *h=calloc(1,sizeof(struct stub));
+
+    if( h != NULL )
+        h->type = type;
+    return h;
+}
+
+static void stub_free(struct stub *h);
+
+/* the implicit results belong to the statement until it is executed again */
+static void stub_free_results(struct stub *h)
+{
+    ub4 i;
+
+    for( i=0 ; i < h->next_result ; i++ )
+        stub_free( h->results[i] );
+    free( h->results );
+    h->results = NULL;
+    h->nresults = 0;
+    h->next_result = 0;
+}
+
+static void stub_free(struct stub *h)
+{
+    if( h == NULL )
+        return;
+    stub_free_results( h );
+    while( h->binds != NULL ){
+        struct stub *next=h->binds->binds;
+
+        free( h->binds );
+        h->binds = next;
+    }
+    free( h->text );
+    free( h->columns );
+    free( h->params );
+    free( h->data );
+    if( h->server != NULL )
+        free( h->server );
+    free( h );
+}
+
+static sword stub_error(OCIError *errhp,sb4 code,const char *message)
+{
+    struct stub *err=(struct stub*)errhp;
+
+    if( err != NULL ){
+        err->code = code;
+        snprintf( err->message , sizeof(err->message) ,
+                "ORA-%05d: %s\n" , (int)code , message );
+    }
+    return OCI_ERROR;
+}
+
+/* read `key=N` from the SQL text */
+static ub4 stub_number(const char *sql,const char *key,ub4 def)
+{
+    const char *p=strstr(sql,key);
+
+    if( p == NULL || ! isdigit((unsigned char)p[strlen(key)]) )
+        return def;
+    return (ub4)strtoul(p+strlen(key),NULL,10);
+}
+
+static const char *stub_keyword(const char *p)
+{
+    for(;;){
+        while( isspace((unsigned char)*p) || *p == '(' )
+            p++;
+        if( p[0] == '/' && p[1] == '*' ){
+            const char *end=strstr(p+2,"*/");
+            p = ( end != NULL ? end+2 : p+strlen(p) );
+        }else if( p[0] == '-' && p[1] == '-' ){
+            while( *p != '\0' && *p != '\n' )
+                p++;
+        }else{
+            return p;
+        }
+    }
+}
+
+static ub2 stub_stmt_type(const char *sql)
+{
+    static const struct { const char *word; ub2 type; } list[]={
+        { "SELECT" , OCI_STMT_SELECT } ,
+        { "WITH"   , OCI_STMT_SELECT } ,
+        { "INSERT" , OCI_STMT_INSERT } ,
+        { "UPDATE" , OCI_STMT_UPDATE } ,
+        { "DELETE" , OCI_STMT_DELETE } ,
+        { "MERGE"  , OCI_STMT_MERGE } ,
+        { "BEGIN"  , OCI_STMT_BEGIN } ,
+        { "DECLARE", OCI_STMT_DECLARE } ,
+        { "CALL"   , OCI_STMT_CALL } ,
+        { "CREATE" , OCI_STMT_CREATE } ,
+        { "DROP"   , OCI_STMT_DROP } ,
+        { "ALTER"  , OCI_STMT_ALTER } ,
+        { NULL , 0 } ,
+    };
+    const char *p=stub_keyword(sql);
+    size_t len=0;
+    int i,j;
+
+    while( isalpha((unsigned char)p[len]) )
+        len++;
+    for( i=0 ; list[i].word != NULL ; i++ ){
+        if( strlen(list[i].word) != len )
+            continue;
+        for( j=0 ; j < (int)len && toupper((unsigned char)p[j]) == list[i].word[j] ; j++ )
+            ;
+        if( j == (int)len )
+            return list[i].type;
+    }
+    return 0;
+}
+
+/* count the placeholders :NAME and :N out of the quoted strings */
+static ub4 stub_bind_count(const char *sql)
+{
+    ub4 count=0;
+    int quote=0;
+
+    for( ; *sql != '\0' ; sql++ ){
+        if( *sql == '\'' )
+            quote = !quote;
+        else if( !quote && sql[0] == ':' &&
+                 ( isalnum((unsigned char)sql[1]) || sql[1] == '_' ) )
+            count++;
+    }
+    return count;
+}
+
+static sword stub_describe(struct stub *stmt,const char *sql,OCIError *errhp)
+{
+    char types[ STUB_TYPES_MAX+1 ]="i";
+    const char *p=strstr(sql,"types=");
+    ub2 size=(ub2)stub_number(sql,"size=",STUB_SIZE);
+    size_t ntypes;
+    ub4 c;
+
+    if( p != NULL ){
+        for( p+=6 , ntypes=0 ; isalpha((unsigned char)*p) && ntypes < STUB_TYPES_MAX ; p++ )
+            types[ntypes++] = *p;
+        if( ntypes > 0 )
+            types[ntypes] = '\0';
+    }
+    ntypes = strlen(types);
+
+    stmt->ncols = stub_number(sql,"cols=",STUB_COLS);
+    stmt->columns = calloc(stmt->ncols ? stmt->ncols : 1,sizeof(struct stub_column));
+    stmt->params  = calloc(stmt->ncols ? stmt->ncols : 1,sizeof(struct stub));
+    if( stmt->columns == NULL || stmt->params == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+
+    for( c=0 ; c < stmt->ncols ; c++ ){
+        struct stub_column *col=&stmt->columns[c];
+
+        col->letter = types[ c % ntypes ];
+        snprintf( col->name , sizeof(col->name) , "C%u" , (unsigned)c+1 );
+        switch( col->letter ){
+        case 'n':
+            col->type = SQLT_NUM; col->size = 22; col->precision = 0; col->scale = -127;
+            break;
+        case 's':
+            col->type = SQLT_CHR; col->size = size;
+            break;
+        case 'd':
+            col->type = SQLT_DAT; col->size = 7;
+            break;
+        case 't':
+            col->type = SQLT_TIMESTAMP; col->size = 11;
+            break;
+        case 'z':
+            col->type = SQLT_TIMESTAMP_TZ; col->size = 13;
+            break;
+        case 'c':
+            col->type = SQLT_CLOB; col->size = 86;
+            break;
+        default:
+            col->type = SQLT_NUM; col->size = 22; col->precision = 10; col->scale = 0;
+            break;
+        }
+        stmt->params[c].type = OCI_DTYPE_PARAM;
+        stmt->params[c].column = col;
+    }
+    return OCI_SUCCESS;
+}
+
+static void stub_lob_set(struct stub *lob,const char *p,size_t len)
+{
+    char *data=malloc(len ? len : 1);
+
+    if( data == NULL )
+        return;
+    memcpy( data , p , len );
+    free( lob->data );
+    lob->data = data;
+    lob->len = len;
+}
+
+/* put the value of the cell (row,c) at the index i of the define array */
+static void stub_cell(struct stub *stmt,ub4 c,ub4 row,ub4 i)
+{
+    struct stub_column *col=&stmt->columns[c];
+    char *p=col->valuep + (size_t)col->value_sz * i;
+    char text[64];
+    ub4 len=(ub4)col->value_sz;
+    ub4 sec=row % 86400;
+    int n;
+
+    if( col->valuep == NULL )
+        return;
+    if( stmt->nulls > 0 && (row * stmt->ncols + c) % stmt->nulls == stmt->nulls-1 ){
+        if( col->indp != NULL )
+            col->indp[i] = OCI_IND_NULL;
+        if( col->rlenp != NULL )
+            col->rlenp[i] = 0;
+        return;
+    }
+    if( col->indp != NULL )
+        col->indp[i] = OCI_IND_NOTNULL;
+
+    switch( col->dty ){
+    case SQLT_INT:
+        if( col->value_sz == sizeof(sb8) )
+            *(sb8*)p = (sb8)row * 1000 + c;
+        else
+            *(sb4*)p = (sb4)(row * 1000 + c);
+        break;
+    case SQLT_FLT:
+        if( col->value_sz == sizeof(double) )
+            *(double*)p = row + c / 100.0;
+        else
+            *(float*)p = (float)(row + c / 100.0);
+        break;
+    case SQLT_DAT:
+        p[0] = 120; p[1] = 126; p[2] = 1 + row % 12; p[3] = 1 + row % 28;
+        p[4] = (char)(sec/3600 + 1); p[5] = (char)(sec/60%60 + 1); p[6] = (char)(sec%60 + 1);
+        len = 7;
+        break;
+    case SQLT_TIMESTAMP:
+    case SQLT_TIMESTAMP_TZ:
+    case SQLT_TIMESTAMP_LTZ:
+        {
+            struct stub *dt=*(struct stub**)p;
+
+            if( dt != NULL ){
+                dt->year = 2026; dt->month = 1 + row % 12; dt->day = 1 + row % 28;
+                dt->hour = sec/3600; dt->min = sec/60%60; dt->sec = sec%60;
+                dt->fsec = (row % 1000) * 1000000;
+                dt->tzh = 9; dt->tzm = 0;
+            }
+            len = sizeof(dvoid*);
+        }
+        break;
+    case SQLT_CLOB:
+    case SQLT_BLOB:
+        {
+            struct stub *lob=*(struct stub**)p;
+
+            n = snprintf(text,sizeof(text),"CLOB R%uC%u",(unsigned)row+1,(unsigned)c+1);
+            if( lob != NULL )
+                stub_lob_set(lob,text,(size_t)n);
+            len = sizeof(dvoid*);
+        }
+        break;
+    default:
+        n = snprintf(text,sizeof(text),"R%uC%u",(unsigned)row+1,(unsigned)c+1);
+        if( (ub4)n > len )
+            n = (int)len;
+        memcpy( p , text , n );
+        if( col->dty == SQLT_STR && (ub4)n < len )
+            p[n] = '\0';
+        len = (ub4)n;
+        break;
+    }
+    if( col->rlenp != NULL )
+        col->rlenp[i] = (ub2)len;
+}
+
+static ub4 stub_fetch(struct stub *stmt,ub4 nrows)
+{
+    ub4 i,c;
+
+    if( stmt->position > stmt->rows )
+        stmt->position = stmt->rows;
+    if( nrows > stmt->rows - stmt->position )
+        nrows = stmt->rows - stmt->position;
+    for( i=0 ; i < nrows ; i++ ){
+        for( c=0 ; c < stmt->ncols ; c++ )
+            stub_cell(stmt,c,stmt->position + i,i);
+    }
+    stmt->position += nrows;
+    stmt->fetched = nrows;
+    return nrows;
+}
+
+/*** environment and handles ***/
+
+sword OCIEnvCreate(OCIEnv **envp, ub4 mode, dvoid *ctxp,
+        dvoid *(*malocfp)(dvoid *ctxp, size_t size),
+        dvoid *(*ralocfp)(dvoid *ctxp, dvoid *memptr, size_t newsize),
+        void (*mfreefp)(dvoid *ctxp, dvoid *memptr),
+        size_t xtramem_sz, dvoid **usrmempp)
+{
+    *envp = (OCIEnv*)stub_new(OCI_HTYPE_ENV);
+    return *envp != NULL ? OCI_SUCCESS : OCI_ERROR;
+}
+
+sword OCIHandleAlloc(const dvoid *parenth, dvoid **hndlpp, const ub4 type,
+        const size_t xtramem_sz, dvoid **usrmempp)
+{
+    struct stub *h=stub_new(type);
+
+    if( h == NULL )
+        return OCI_ERROR;
+    if( type == OCI_HTYPE_DIRPATH_COLUMN_ARRAY || type == OCI_HTYPE_DIRPATH_STREAM )
+        h->parent = (struct stub*)parenth;
+    *hndlpp = h;
+    return OCI_SUCCESS;
+}
+
+sword OCIHandleFree(dvoid *hndlp, const ub4 type)
+{
+    stub_free(hndlp);
+    return OCI_SUCCESS;
+}
+
+sword OCIDescriptorAlloc(const dvoid *parenth, dvoid **descpp, const ub4 type,
+        const size_t xtramem_sz, dvoid **usrmempp)
+{
+    *descpp = stub_new(type);
+    return *descpp != NULL ? OCI_SUCCESS : OCI_ERROR;
+}
+
+sword OCIDescriptorFree(dvoid *descp, const ub4 type)
+{
+    /* parameters belong to the statement or the direct path context */
+    if( type != OCI_DTYPE_PARAM )
+        stub_free(descp);
+    return OCI_SUCCESS;
+}
+
+sword OCIParamGet(const dvoid *hndlp, ub4 htype, OCIError *errhp,
+        dvoid **parmdpp, ub4 pos)
+{
+    const struct stub *h=hndlp;
+
+    if( h->params == NULL || pos < 1 || pos > h->ncols )
+        return stub_error(errhp,24334,"no descriptor for this position");
+    *parmdpp = &h->params[pos-1];
+    return OCI_SUCCESS;
+}
+
+sword OCIErrorGet(dvoid *hndlp, ub4 recordno, OraText *sqlstate,
+        sb4 *errcodep, OraText *bufp, ub4 bufsiz, ub4 type)
+{
+    struct stub *err=hndlp;
+
+    if( err == NULL || err->code == 0 || recordno != 1 )
+        return OCI_NO_DATA;
+    *errcodep = err->code;
+    snprintf( (char*)bufp , bufsiz , "%s" , err->message );
+    return OCI_SUCCESS;
+}
+
+sword OCIAttrGet(const dvoid *trgthndlp, ub4 trghndltyp, dvoid *attributep,
+        ub4 *sizep, ub4 attrtype, OCIError *errhp)
+{
+    const struct stub *h=trgthndlp;
+
+    if( trghndltyp == OCI_HTYPE_STMT ){
+        switch( attrtype ){
+        case OCI_ATTR_STMT_TYPE:
+            *(ub2*)attributep = h->stmt_type;
+            return OCI_SUCCESS;
+        case OCI_ATTR_PARAM_COUNT:
+            *(ub4*)attributep = h->ncols;
+            return OCI_SUCCESS;
+        case OCI_ATTR_BIND_COUNT:
+            *(ub4*)attributep = h->bind_count;
+            return OCI_SUCCESS;
+        case OCI_ATTR_ROWS_FETCHED:
+            *(ub4*)attributep = h->fetched;
+            return OCI_SUCCESS;
+        case OCI_ATTR_ROW_COUNT:
+            *(ub4*)attributep = h->row_count;
+            return OCI_SUCCESS;
+        case OCI_ATTR_NUM_DML_ERRORS:
+            *(ub4*)attributep = 0;
+            return OCI_SUCCESS;
+        case OCI_ATTR_IMPLICIT_RESULT_COUNT:
+            *(ub4*)attributep = h->nresults;
+            return OCI_SUCCESS;
+        }
+    }else if( trghndltyp == OCI_DTYPE_PARAM && h->column != NULL ){
+        switch( attrtype ){
+        case OCI_ATTR_DATA_SIZE:
+            *(ub2*)attributep = h->column->size;
+            return OCI_SUCCESS;
+        case OCI_ATTR_DATA_TYPE:
+            *(ub2*)attributep = h->column->type;
+            return OCI_SUCCESS;
+        case OCI_ATTR_PRECISION:
+            *(sb2*)attributep = h->column->precision;
+            return OCI_SUCCESS;
+        case OCI_ATTR_SCALE:
+            *(sb1*)attributep = h->column->scale;
+            return OCI_SUCCESS;
+        case OCI_ATTR_NAME:
+            *(const char**)attributep = h->column->name;
+            if( sizep != NULL )
+                *sizep = (ub4)strlen(h->column->name);
+            return OCI_SUCCESS;
+        }
+    }else if( trghndltyp == OCI_HTYPE_SVCCTX && attrtype == OCI_ATTR_SERVER ){
+        *(struct stub**)attributep = h->server;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_SVCCTX && attrtype == OCI_ATTR_SESSION ){
+        /* the server handle stands for the session, too */
+        *(struct stub**)attributep = h->server;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_SESSION && attrtype == OCI_ATTR_CALL_TIME ){
+        *(ub8*)attributep = 0;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_SPOOL ){
+        if( attrtype == OCI_ATTR_SPOOL_BUSY_COUNT ){
+            *(ub4*)attributep = h->busy;
+            return OCI_SUCCESS;
+        }else if( attrtype == OCI_ATTR_SPOOL_OPEN_COUNT ){
+            *(ub4*)attributep = h->open;
+            return OCI_SUCCESS;
+        }
+    }else if( trghndltyp == OCI_HTYPE_DIRPATH_CTX && attrtype == OCI_ATTR_LIST_COLUMNS ){
+        *(const struct stub**)attributep = h;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_DIRPATH_COLUMN_ARRAY && attrtype == OCI_ATTR_NUM_ROWS ){
+        *(ub4*)attributep = ( h->parent != NULL && h->parent->num_rows > 0 )
+                            ? h->parent->num_rows : STUB_DIRPATH_ROWS ;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_BIND && attrtype == OCI_ATTR_ROWS_RETURNED ){
+        *(ub4*)attributep = 1;
+        return OCI_SUCCESS;
+    }else if( trghndltyp == OCI_HTYPE_ERROR && attrtype == OCI_ATTR_DML_ROW_OFFSET ){
+        *(ub4*)attributep = 0;
+        return OCI_SUCCESS;
+    }
+    return stub_error(errhp,24315,"illegal attribute type (not in ocistub.c)");
+}
+
+sword OCIAttrSet(dvoid *trgthndlp, ub4 trghndltyp, dvoid *attributep,
+        ub4 size, ub4 attrtype, OCIError *errhp)
+{
+    struct stub *h=trgthndlp;
+
+    if( trghndltyp == OCI_HTYPE_SERVER && attrtype == OCI_ATTR_NONBLOCKING_MODE ){
+        /* toggles as the real one */
+        h->nonblocking = !h->nonblocking;
+    }else if( trghndltyp == OCI_HTYPE_DIRPATH_CTX && attrtype == OCI_ATTR_NUM_ROWS ){
+        h->num_rows = *(ub4*)attributep;
+    }else if( trghndltyp == OCI_HTYPE_DIRPATH_CTX && attrtype == OCI_ATTR_NUM_COLS ){
+        ub4 c;
+
+        free( h->columns );
+        free( h->params );
+        h->ncols = *(ub2*)attributep;
+        h->columns = calloc(h->ncols ? h->ncols : 1,sizeof(struct stub_column));
+        h->params  = calloc(h->ncols ? h->ncols : 1,sizeof(struct stub));
+        if( h->columns == NULL || h->params == NULL )
+            return stub_error(errhp,4030,"out of process memory");
+        for( c=0 ; c < h->ncols ; c++ ){
+            h->params[c].type = OCI_DTYPE_PARAM;
+            h->params[c].column = &h->columns[c];
+        }
+    }
+    /* the others are accepted and ignored */
+    return OCI_SUCCESS;
+}
+
+/*** sessions ***/
+
+static OCISvcCtx *stub_svcctx(struct stub *pool)
+{
+    struct stub *svc=stub_new(OCI_HTYPE_SVCCTX);
+
+    if( svc == NULL )
+        return NULL;
+    if( (svc->server = stub_new(OCI_HTYPE_SERVER)) == NULL ){
+        free( svc );
+        return NULL;
+    }
+    svc->pool = pool;
+    return (OCISvcCtx*)svc;
+}
+
+sword OCILogon(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp,
+        const OraText *username, ub4 uname_len,
+        const OraText *password, ub4 passwd_len,
+        const OraText *dbname, ub4 dbname_len)
+{
+    if( (*svchp = stub_svcctx(NULL)) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    return OCI_SUCCESS;
+}
+
+sword OCILogoff(OCISvcCtx *svchp, OCIError *errhp)
+{
+    stub_free((struct stub*)svchp);
+    return OCI_SUCCESS;
+}
+
+sword OCISessionPoolCreate(OCIEnv *envhp, OCIError *errhp, OCISPool *spoolhp,
+        OraText **poolName, ub4 *poolNameLen,
+        const OraText *connStr, ub4 connStrLen,
+        ub4 sessMin, ub4 sessMax, ub4 sessIncr,
+        OraText *userid, ub4 useridLen,
+        OraText *password, ub4 passwordLen, ub4 mode)
+{
+    struct stub *pool=(struct stub*)spoolhp;
+
+    strcpy( pool->name , "OCISTUB" );
+    pool->open = sessMin;
+    *poolName = (OraText*)pool->name;
+    *poolNameLen = (ub4)strlen(pool->name);
+    return OCI_SUCCESS;
+}
+
+sword OCISessionPoolDestroy(OCISPool *spoolhp, OCIError *errhp, ub4 mode)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCISessionGet(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp,
+        OCIAuthInfo *authhp, OraText *poolName, ub4 poolName_len,
+        const OraText *tagInfo, ub4 tagInfo_len,
+        OraText **retTagInfo, ub4 *retTagInfo_len,
+        boolean *found, ub4 mode)
+{
+    struct stub *pool=NULL;
+
+    /* the pool name is the member `name` of the pool handle */
+    if( poolName != NULL )
+        pool = (struct stub*)( (char*)poolName - offsetof(struct stub,name) );
+    if( (*svchp = stub_svcctx(pool)) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    if( pool != NULL ){
+        ub4 busy=__sync_add_and_fetch(&pool->busy,1);
+
+        if( busy > pool->open )
+            pool->open = busy;
+    }
+    if( found != NULL )
+        *found = FALSE;
+    return OCI_SUCCESS;
+}
+
+sword OCISessionRelease(OCISvcCtx *svchp, OCIError *errhp,
+        OraText *tag, ub4 tag_len, ub4 mode)
+{
+    struct stub *svc=(struct stub*)svchp;
+
+    if( svc->pool != NULL )
+        __sync_sub_and_fetch(&svc->pool->busy,1);
+    stub_free(svc);
+    return OCI_SUCCESS;
+}
+
+sword OCITransCommit(OCISvcCtx *svchp, OCIError *errhp, ub4 flags)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCITransRollback(OCISvcCtx *svchp, OCIError *errhp, ub4 flags)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIBreak(dvoid *hndlp, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIReset(dvoid *hndlp, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+/*** statements ***/
+
+sword OCIStmtPrepare(OCIStmt *stmtp, OCIError *errhp, const OraText *stmt,
+        ub4 stmt_len, ub4 language, ub4 mode)
+{
+    struct stub *h=(struct stub*)stmtp;
+    char *sql=malloc(stmt_len+1);
+    sword status=OCI_SUCCESS;
+
+    if( sql == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    memcpy( sql , stmt , stmt_len );
+    sql[stmt_len] = '\0';
+
+    free( h->columns );
+    free( h->params );
+    h->columns = NULL;
+    h->params = NULL;
+    h->ncols = 0;
+
+    h->stmt_type  = stub_stmt_type(sql);
+    h->bind_count = stub_bind_count(sql);
+    h->rows  = stub_number(sql,"rows=",STUB_ROWS);
+    h->nulls = stub_number(sql,"nulls=",0);
+    h->delay = stub_number(sql,"delay=",0);
+    stub_free_results(h);
+    free( h->text );
+    h->text = NULL;
+    if( h->stmt_type == OCI_STMT_SELECT )
+        status = stub_describe(h,sql,errhp);
+    if( h->stmt_type == OCI_STMT_BEGIN || h->stmt_type == OCI_STMT_DECLARE ){
+        h->text = sql;
+        return status;
+    }
+    free( sql );
+    return status;
+}
+
+/* call the callbacks of the binds of OCI_DATA_AT_EXEC for each iteration */
+static sword stub_dynamic(struct stub *h,ub4 iters,OCIError *errhp)
+{
+    struct stub *b;
+    ub4 iter;
+
+    for( b=h->binds ; b != NULL ; b=b->binds ){
+        if( b->ocbfp == NULL )
+            continue;
+        for( iter=0 ; iter < iters ; iter++ ){
+            dvoid *inbuf=NULL, *outbuf=NULL, *ind=NULL;
+            ub4 inlen=0, *alen=NULL;
+            ub2 *rcode=NULL;
+            ub1 piece=OCI_ONE_PIECE;
+
+            if( b->icbfp(b->ictxp,(OCIBind*)b,iter,0,&inbuf,&inlen,&piece,&ind) != OCI_CONTINUE ||
+                b->ocbfp(b->octxp,(OCIBind*)b,iter,0,&outbuf,&alen,&piece,&ind,&rcode) != OCI_CONTINUE )
+                return stub_error(errhp,24343,"user defined callback error");
+            if( h->text != NULL && inbuf != NULL ){
+                if( inlen > *alen )
+                    inlen = *alen;
+                memcpy(outbuf,inbuf,inlen);
+                *alen = inlen;
+            }else if( b->dty == SQLT_INT ){
+                *(sb8*)outbuf = ++h->sequence;
+            }else if( b->dty == SQLT_FLT ){
+                *(double*)outbuf = ++h->sequence;
+            }else{
+                char number[16];
+                ub4 len=(ub4)snprintf(number,sizeof(number),"%u",(unsigned)++h->sequence);
+
+                if( len > *alen )
+                    len = *alen;
+                memcpy(outbuf,number,len);
+                *alen = len;
+            }
+            *(sb2*)ind = 0;
+        }
+    }
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtExecute(OCISvcCtx *svchp, OCIStmt *stmtp, OCIError *errhp,
+        ub4 iters, ub4 rowoff, const OCISnapshot *snap_in,
+        OCISnapshot *snap_out, ub4 mode)
+{
+    struct stub *svc=(struct stub*)svchp;
+    struct stub *h=(struct stub*)stmtp;
+
+    if( svc->server->nonblocking && h->waits < h->delay ){
+        h->waits++;
+        return OCI_STILL_EXECUTING;
+    }
+    h->waits = 0;
+    h->fetched = 0;
+    h->row_count = 0;
+
+    if( h->stmt_type == OCI_STMT_SELECT ){
+        h->position = 0;
+        if( iters > 0 )
+            h->row_count = stub_fetch(h,iters);
+    }else if( iters == 0 ){
+        return stub_error(errhp,24333,"zero iteration count");
+    }else if( h->stmt_type == OCI_STMT_INSERT || h->stmt_type == OCI_STMT_UPDATE ||
+              h->stmt_type == OCI_STMT_DELETE || h->stmt_type == OCI_STMT_MERGE ){
+        h->row_count = iters;
+    }else if( h->text != NULL ){
+        stub_free_results(h);
+        h->nresults = stub_number(h->text,"results=",0);
+    }
+    if( h->stmt_type != OCI_STMT_SELECT )
+        return stub_dynamic(h,iters,errhp);
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtGetNextResult(OCIStmt *stmthp, OCIError *errhp, dvoid **result,
+        ub4 *rtype, ub4 mode)
+{
+    struct stub *h=(struct stub*)stmthp;
+    struct stub *r;
+    sword status;
+
+    if( h->text == NULL || h->next_result >= h->nresults )
+        return OCI_NO_DATA;
+    if( h->results == NULL &&
+        (h->results = calloc(h->nresults,sizeof(struct stub*))) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    if( (r = stub_new(OCI_HTYPE_STMT)) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    r->stmt_type = OCI_STMT_SELECT;
+    r->rows  = h->rows;
+    r->nulls = h->nulls;
+    if( (status = stub_describe(r,h->text,errhp)) != OCI_SUCCESS ){
+        stub_free(r);
+        return status;
+    }
+    h->results[h->next_result++] = r;
+    *result = r;
+    *rtype = OCI_RESULT_TYPE_SELECT;
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtFetch2(OCIStmt *stmtp, OCIError *errhp, ub4 nrows,
+        ub2 orientation, sb4 scrollOffset, ub4 mode)
+{
+    struct stub *h=(struct stub*)stmtp;
+    ub4 n;
+
+    if( h->stmt_type != OCI_STMT_SELECT )
+        return stub_error(errhp,24374,"define not done before fetch or execute and fetch");
+    /* `position` is the last row fetched (1-based), as OCI_ATTR_CURRENT_POSITION */
+    if( orientation == OCI_FETCH_ABSOLUTE || orientation == OCI_FETCH_RELATIVE ){
+        sb8 first=scrollOffset;
+
+        if( orientation == OCI_FETCH_RELATIVE )
+            first += (sb8)h->position;
+        if( first < 1 || first > (sb8)h->rows ){
+            h->fetched = 0;
+            return OCI_NO_DATA;
+        }
+        h->position = (ub4)(first - 1);
+    }
+    n = stub_fetch(h,nrows);
+    h->row_count += n;
+    return n < nrows ? OCI_NO_DATA : OCI_SUCCESS;
+}
+
+/* a bind of OCI_DATA_AT_EXEC has its own handle (taken over when the
+ * placeholder is bound again), and the others share the statement */
+static sword stub_bind(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp,
+        sb4 value_sz, ub2 dty, ub4 mode)
+{
+    struct stub *h=(struct stub*)stmtp;
+    struct stub *b=(struct stub*)*bindp;
+
+    if( b == NULL || b->type != OCI_HTYPE_BIND || b->parent != h ){
+        if( (mode & OCI_DATA_AT_EXEC) == 0 ){
+            *bindp = (OCIBind*)stmtp;
+            return OCI_SUCCESS;
+        }
+        if( (b = stub_new(OCI_HTYPE_BIND)) == NULL )
+            return stub_error(errhp,4030,"out of process memory");
+        b->parent = h;
+        b->binds = h->binds;
+        h->binds = b;
+    }
+    b->dty = dty;
+    b->value_sz = value_sz;
+    b->icbfp = NULL;
+    b->ocbfp = NULL;
+    *bindp = (OCIBind*)b;
+    return OCI_SUCCESS;
+}
+
+sword OCIBindByPos(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp,
+        ub4 position, dvoid *valuep, sb4 value_sz, ub2 dty,
+        dvoid *indp, ub2 *alenp, ub2 *rcodep,
+        ub4 maxarr_len, ub4 *curelep, ub4 mode)
+{
+    /* the values are not read */
+    return stub_bind(stmtp,bindp,errhp,value_sz,dty,mode);
+}
+
+sword OCIBindByName(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp,
+        const OraText *placeholder, sb4 placeh_len,
+        dvoid *valuep, sb4 value_sz, ub2 dty,
+        dvoid *indp, ub2 *alenp, ub2 *rcodep,
+        ub4 maxarr_len, ub4 *curelep, ub4 mode)
+{
+    return stub_bind(stmtp,bindp,errhp,value_sz,dty,mode);
+}
+
+sword OCIBindDynamic(OCIBind *bindp, OCIError *errhp, dvoid *ictxp,
+        OCICallbackInBind icbfp, dvoid *octxp, OCICallbackOutBind ocbfp)
+{
+    struct stub *b=(struct stub*)bindp;
+
+    if( b == NULL || b->type != OCI_HTYPE_BIND )
+        return stub_error(errhp,1036,"illegal variable name/number");
+    b->ictxp = ictxp;
+    b->icbfp = icbfp;
+    b->octxp = octxp;
+    b->ocbfp = ocbfp;
+    return OCI_SUCCESS;
+}
+
+sword OCIDefineByPos(OCIStmt *stmtp, OCIDefine **defnp, OCIError *errhp,
+        ub4 position, dvoid *valuep, sb4 value_sz, ub2 dty,
+        dvoid *indp, ub2 *rlenp, ub2 *rcodep, ub4 mode)
+{
+    struct stub *h=(struct stub*)stmtp;
+    struct stub_column *col;
+
+    if( position < 1 || position > h->ncols )
+        return stub_error(errhp,1007,"variable not in select list");
+    col = &h->columns[position-1];
+    col->valuep = valuep;
+    col->value_sz = value_sz;
+    col->dty = dty;
+    col->indp = indp;
+    col->rlenp = rlenp;
+    *defnp = (OCIDefine*)col;
+    return OCI_SUCCESS;
+}
+
+/*** datetime ***/
+
+sword OCIDateTimeGetDate(dvoid *hndl, OCIError *err, const OCIDateTime *date,
+        sb2 *yr, ub1 *mnth, ub1 *dy)
+{
+    const struct stub *dt=(const struct stub*)date;
+
+    *yr = dt->year;
+    *mnth = dt->month;
+    *dy = dt->day;
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeGetTime(dvoid *hndl, OCIError *err, OCIDateTime *datetime,
+        ub1 *hr, ub1 *mm, ub1 *ss, ub4 *fsec)
+{
+    const struct stub *dt=(const struct stub*)datetime;
+
+    *hr = dt->hour;
+    *mm = dt->min;
+    *ss = dt->sec;
+    *fsec = dt->fsec;
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeGetTimeZoneOffset(dvoid *hndl, OCIError *err,
+        const OCIDateTime *datetime, sb1 *hr, sb1 *mm)
+{
+    const struct stub *dt=(const struct stub*)datetime;
+
+    *hr = dt->tzh;
+    *mm = dt->tzm;
+    return OCI_SUCCESS;
+}
+
+/*** lob: the value is kept in the locator ***/
+
+sword OCILobCharSetForm(OCIEnv *envhp, OCIError *errhp,
+        const OCILobLocator *locp, ub1 *csfrm)
+{
+    *csfrm = SQLCS_IMPLICIT;
+    return OCI_SUCCESS;
+}
+
+sword OCILobCreateTemporary(OCISvcCtx *svchp, OCIError *errhp,
+        OCILobLocator *locp, ub2 csid, ub1 csfrm, ub1 lobtype,
+        boolean cache, OCIDuration duration)
+{
+    stub_lob_set((struct stub*)locp,"",0);
+    return OCI_SUCCESS;
+}
+
+sword OCILobFreeTemporary(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp)
+{
+    stub_lob_set((struct stub*)locp,"",0);
+    return OCI_SUCCESS;
+}
+
+sword OCILobGetChunkSize(OCISvcCtx *svchp, OCIError *errhp,
+        OCILobLocator *locp, ub4 *chunksizep)
+{
+    *chunksizep = 8132;
+    return OCI_SUCCESS;
+}
+
+sword OCILobGetLength2(OCISvcCtx *svchp, OCIError *errhp,
+        OCILobLocator *locp, oraub8 *lenp)
+{
+    *lenp = ((struct stub*)locp)->len;
+    return OCI_SUCCESS;
+}
+
+sword OCILobLocatorAssign(OCISvcCtx *svchp, OCIError *errhp,
+        const OCILobLocator *src_locp, OCILobLocator **dst_locpp)
+{
+    const struct stub *src=(const struct stub*)src_locp;
+
+    if( *dst_locpp == NULL &&
+        (*dst_locpp = (OCILobLocator*)stub_new(OCI_DTYPE_LOB)) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    stub_lob_set((struct stub*)*dst_locpp,src->data != NULL ? src->data : "",src->len);
+    return OCI_SUCCESS;
+}
+
+/* the amounts are the same in bytes and characters (single byte) */
+sword OCILobRead2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp,
+        oraub8 *byte_amtp, oraub8 *char_amtp, oraub8 offset,
+        dvoid *bufp, oraub8 bufl, ub1 piece, dvoid *ctxp,
+        OCICallbackLobRead2 cbfp, ub2 csid, ub1 csfrm)
+{
+    const struct stub *lob=(const struct stub*)locp;
+    oraub8 amount=( *byte_amtp ? *byte_amtp : *char_amtp );
+    oraub8 rest;
+
+    if( offset < 1 || offset > lob->len ){
+        *byte_amtp = *char_amtp = 0;
+        return OCI_NO_DATA;
+    }
+    rest = lob->len - (offset-1);
+    if( amount == 0 || amount > rest )
+        amount = rest;
+    if( amount > bufl )
+        amount = bufl;
+    memcpy( bufp , lob->data + (offset-1) , (size_t)amount );
+    *byte_amtp = *char_amtp = amount;
+    return OCI_SUCCESS;
+}
+
+sword OCILobWrite2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp,
+        oraub8 *byte_amtp, oraub8 *char_amtp, oraub8 offset,
+        dvoid *bufp, oraub8 buflen, ub1 piece, dvoid *ctxp,
+        OCICallbackLobWrite2 cbfp, ub2 csid, ub1 csfrm)
+{
+    struct stub *lob=(struct stub*)locp;
+    oraub8 amount=buflen;
+    size_t len;
+    char *data;
+
+    if( offset < 1 )
+        offset = 1;
+    len = (size_t)(offset-1 + amount);
+    if( len < lob->len )
+        len = lob->len;
+    if( (data = calloc(1,len ? len : 1)) == NULL )
+        return stub_error(errhp,4030,"out of process memory");
+    if( lob->data != NULL )
+        memcpy( data , lob->data , lob->len );
+    memcpy( data + (offset-1) , bufp , (size_t)amount );
+    free( lob->data );
+    lob->data = data;
+    lob->len = len;
+    *byte_amtp = *char_amtp = amount;
+    return OCI_SUCCESS;
+}
+
+sword OCILobTrim2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp,
+        oraub8 newlen)
+{
+    struct stub *lob=(struct stub*)locp;
+
+    if( newlen < lob->len )
+        lob->len = (size_t)newlen;
+    return OCI_SUCCESS;
+}
+
+/*** direct path: the rows are thrown away ***/
+
+sword OCIDirPathPrepare(OCIDirPathCtx *dpctx, OCISvcCtx *svchp, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayEntrySet(OCIDirPathColArray *dpca, OCIError *errhp,
+        ub4 rownum, ub2 colIdx, ub1 *cvalp, ub4 clen, ub1 cflg)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayToStream(OCIDirPathColArray *dpca,
+        OCIDirPathCtx const *dpctx, OCIDirPathStream *dpstr,
+        OCIError *errhp, ub4 rowcnt, ub4 rowoff)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayReset(OCIDirPathColArray *dpca, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathLoadStream(OCIDirPathCtx *dpctx, OCIDirPathStream *dpstr,
+        OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathStreamReset(OCIDirPathStream *dpstr, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathFinish(OCIDirPathCtx *dpctx, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathAbort(OCIDirPathCtx *dpctx, OCIError *errhp)
+{
+    return OCI_SUCCESS;
+}
@@ -2,6 +2,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#  include <pthread.h>
+#endif
 
 #include "lua.h"
 #include "lualib.h"
@@ -11,6 +17,14 @@
 #define TNAME_STATEMENT  "org.nyaos.oluacle.statement"
 #define TNAME_CONNECTION "org.nyaos.oluacle.connection"
 #define TNAME_ENVIRON    "org.nyaos.oluacle.environ"
+#define TNAME_POOL       "org.nyaos.oluacle.pool"
+#define TNAME_LOB        "org.nyaos.oluacle.lob"
+#define TNAME_PARALLEL   "org.nyaos.oluacle.parallel"
+#define TNAME_THREADED   "org.nyaos.oluacle.threaded"
+#define TNAME_EXPORT     "org.nyaos.oluacle.export"
+#define TNAME_LOAD       "org.nyaos.oluacle.load"
+#define TNAME_DIRPATH    "org.nyaos.oluacle.dirpath"
+#define TNAME_OUTBIND    "org.nyaos.oluacle.outbind"
 
 #if 0
 #  undef  DEBUG
@@ -19,6 +33,26 @@
 #  define DEBUG(x) ;
 #endif
 
+#define OLUA_ALIGN(n) ( ((n)+7) & ~(size_t)7 )
+
+#define OLUA_DEFAULT_FETCH_SIZE 100
+#define OLUA_DEFAULT_STMTCACHE  20
+#define OLUA_DEFAULT_BATCH      1000
+
+/* push a 64bit integer. before Lua 5.3, lua_Integer may be 32bit. */
+#if LUA_VERSION_NUM >= 503
+#  define olua_pushint64(L,n) lua_pushinteger(L,(lua_Integer)(n))
+#else
+#  define olua_pushint64(L,n) lua_pushnumber(L,(lua_Number)(n))
+#endif
+
+#ifndef LUAI_MAXNUMBER2STR
+#  define LUAI_MAXNUMBER2STR 32
+#endif
+#ifndef LUA_NUMBER_FMT
+#  define LUA_NUMBER_FMT "%.14g"
+#endif
+
 #ifdef MEMORY_TEST
 void *MALLOC(size_t size)
 {
@@ -37,6 +71,159 @@ void FREE(void *p)
 #define free(p) FREE(p)
 #endif
 
+/* monotonic clock in nano-seconds */
+static unsigned long long olua_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if( freq.QuadPart == 0 )
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (unsigned long long)( (double)count.QuadPart * 1e9 / (double)freq.QuadPart );
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+/* wait a milli-second between polls of the non-blocking mode */
+static void olua_sleep(void)
+{
+#ifdef _WIN32
+    Sleep(1);
+#else
+    struct timespec ts={ 0 , 1000000 };
+
+    nanosleep(&ts,NULL);
+#endif
+}
+
+/* wall clock in seconds since the epoch, for the lines of the option `trace` */
+static double olua_epoch(void)
+{
+#ifdef _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER t;
+
+    GetSystemTimeAsFileTime(&ft);
+    t.LowPart  = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    /* 100 nano-seconds since 1601/01/01 */
+    return (double)(t.QuadPart - 116444736000000000ULL) / 1e7;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME,&ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Counters of the work of statements. Each statement keeps its own, and
+ * they are also added to its connection and to the totals of the process
+ * (oluacle.stats). Calls made by the worker threads of pool:parallel are
+ * not counted.
+ */
+struct olua_counters {
+    unsigned long long prepare_ns;  /* time in OCIStmtPrepare */
+    unsigned long long execute_ns;  /* time in OCIStmtExecute */
+    unsigned long long fetch_ns;    /* time in OCIStmtFetch2 */
+    unsigned long long prepares;
+    unsigned long long executes;
+    unsigned long long fetches;     /* calls of OCIStmtFetch2 (round-trips) */
+    unsigned long long rows;        /* rows fetched */
+    unsigned long long bytes;       /* bytes of the values converted */
+    unsigned long long binds;       /* values bound */
+};
+
+static struct olua_counters olua_totals;
+
+#define OLUA_COUNT(statement,member,n) do{ \
+        unsigned long long olua_n_=(n); \
+        (statement)->counters.member += olua_n_; \
+        if( (statement)->conn != NULL ) \
+            (statement)->conn->counters.member += olua_n_; \
+        olua_totals.member += olua_n_; \
+    }while(0)
+
+/* the time since `start` also counts for the current execution */
+#define OLUA_COUNT_TIME(statement,member,start) do{ \
+        unsigned long long olua_ns_=olua_now()-(start); \
+        OLUA_COUNT(statement,member,olua_ns_); \
+        (statement)->run_ns += olua_ns_; \
+    }while(0)
+
+/* olua_pushcounters
+ *   push the table of the counters. The times are in seconds.
+ */
+static void olua_pushcounters(lua_State *lua,const struct olua_counters *c)
+{
+    lua_createtable(lua,0,9);
+    lua_pushnumber(lua,(lua_Number)c->prepare_ns / 1e9);
+    lua_setfield(lua,-2,"prepare");
+    lua_pushnumber(lua,(lua_Number)c->execute_ns / 1e9);
+    lua_setfield(lua,-2,"execute");
+    lua_pushnumber(lua,(lua_Number)c->fetch_ns / 1e9);
+    lua_setfield(lua,-2,"fetch");
+    lua_pushnumber(lua,(lua_Number)c->prepares);
+    lua_setfield(lua,-2,"prepares");
+    lua_pushnumber(lua,(lua_Number)c->executes);
+    lua_setfield(lua,-2,"executes");
+    lua_pushnumber(lua,(lua_Number)c->fetches);
+    lua_setfield(lua,-2,"fetches");
+    lua_pushnumber(lua,(lua_Number)c->rows);
+    lua_setfield(lua,-2,"rows");
+    lua_pushnumber(lua,(lua_Number)c->bytes);
+    lua_setfield(lua,-2,"bytes");
+    lua_pushnumber(lua,(lua_Number)c->binds);
+    lua_setfield(lua,-2,"binds");
+}
+
+/** olua_stats
+ * stack-out:
+ *   (+1) table of the counters of all statements of the process
+ */
+int olua_stats(lua_State *lua)
+{
+    olua_pushcounters(lua,&olua_totals);
+    return 1;
+}
+
+/* Non-blocking mode (the option `async`): when an OCI call returns
+ * OCI_STILL_EXECUTING in a coroutine, the lua-function yields the address
+ * of olua_pending, and its continuation calls the lua-function again with
+ * the same stack, which calls the OCI function again. Out of a coroutine,
+ * the call is polled until it completes.
+ */
+static char olua_pending;
+
+static int olua_yieldable(lua_State *lua)
+{
+#if LUA_VERSION_NUM >= 503
+    return lua_isyieldable(lua);
+#else
+    int ismain=lua_pushthread(lua);
+    lua_pop(lua,1);
+    return ! ismain;
+#endif
+}
+
+#if LUA_VERSION_NUM >= 503
+#  define OLUA_CONTINUATION(f) \
+    static int f##_k(lua_State *lua,int status,lua_KContext ctx){ \
+        (void)status; lua_settop(lua,(int)ctx); return f(lua); }
+#else
+#  define OLUA_CONTINUATION(f) \
+    static int f##_k(lua_State *lua){ \
+        int ctx=0; lua_getctx(lua,&ctx); lua_settop(lua,ctx); return f(lua); }
+#endif
+#define OLUA_YIELD(lua,f) \
+    ( lua_pushlightuserdata(lua,&olua_pending) , \
+      lua_yieldk(lua,1,lua_gettop(lua)-1,f##_k) )
+
 static sword checkerr( lua_State *lua , OCIError *errhp , sword status )
 {
     text errbuf[512];
@@ -93,6 +280,7 @@ static sword checkerr( lua_State *lua , OCIError *errhp , sword status )
 static OCIEnv *olua_envhp(lua_State *lua)
 {
     OCIEnv *envhp=NULL;
+    ub4 mode;
     sword status;
 
     lua_getfield(lua,LUA_REGISTRYINDEX,TNAME_ENVIRON);
@@ -102,7 +290,10 @@ static OCIEnv *olua_envhp(lua_State *lua)
         return envhp;
 
     /* first */
-    status = OCIEnvCreate(&envhp,OCI_DEFAULT,NULL,NULL,NULL,NULL,0,NULL);
+    lua_getfield(lua,LUA_REGISTRYINDEX,TNAME_THREADED);
+    mode = lua_toboolean(lua,-1) ? OCI_THREADED : OCI_DEFAULT ;
+    lua_pop(lua,1);
+    status = OCIEnvCreate(&envhp,mode,NULL,NULL,NULL,NULL,0,NULL);
     if( status != OCI_SUCCESS ){
         checkerr(lua,NULL,status);
         abort();
@@ -113,59 +304,93 @@ static OCIEnv *olua_envhp(lua_State *lua)
     return envhp;
 }
 
+/** olua_environ
+ *
+ * stack-in:
+ *   (+1) { threaded=BOOL }
+ *   set how the OCI environment is created. The environment is created
+ *   on the first connection, so this has to be called before it.
+ */
+int olua_environ(lua_State *lua)
+{
+    int threaded;
+
+    luaL_checktype(lua,1,LUA_TTABLE);
+    lua_getfield(lua,1,"threaded");
+    threaded = lua_toboolean(lua,-1);
+    lua_getfield(lua,LUA_REGISTRYINDEX,TNAME_THREADED);
+    if( lua_toboolean(lua,-1) != threaded ){
+        lua_getfield(lua,LUA_REGISTRYINDEX,TNAME_ENVIRON);
+        if( lua_touserdata(lua,-1) != NULL )
+            return luaL_error(lua,"the environment has been created already. call oluacle.environ before connecting");
+        lua_pushboolean(lua,threaded);
+        lua_setfield(lua,LUA_REGISTRYINDEX,TNAME_THREADED);
+    }
+    return 0;
+}
+
+/* One slot per placeholder of a statement, kept over executions in the
+ * array statement->bind_buffer in the order of the first bind. The value
+ * is overwritten in place, and the slot is bound again only when it is new,
+ * grown or the type of the value changes.
+ */
 struct olua_bind_buffer {
-    struct olua_bind_buffer *next;
     OCIBind *bind;
     union {
         char *s;
         unsigned char *u;
-    }name;
+    }name;          /* ":NAME", or NULL for the position */
+    ub4 pos;
+    ub2 dty;        /* data type bound now (0: not bound yet) */
+    size_t size;    /* bytes of the member u */
+    size_t alloc;   /* bytes of the slot with the name after u */
     sb2 indicator;
     union{
-        sword number;
-        char  buffer[1];
+        sb8    integer;
+        double number;
+        OCILobLocator *locator;
+        OCIStmt *cursor;
+        char   buffer[1];
     }u;
 };
 
-static struct olua_bind_buffer *olua_bind_buffer_new( size_t size )
-{
-    struct olua_bind_buffer *p = malloc( sizeof(struct olua_bind_buffer)+size );
-    if( p == NULL )
-        return NULL;
-
-    p->next = NULL;
-    p->bind = NULL;
-    p->name.u = NULL;
-    p->indicator = 0;
-    p->u.buffer[0] = '\0';
-    return p;
-}
+/* b->dty of a slot bound to an out-object by olua_outbind_set */
+#define OLUA_DTY_OUT 0xFFFF
 
-static void olua_bind_buffer_gc( struct olua_bind_buffer *p )
-{
-    while( p != NULL ){
-        struct olua_bind_buffer *q=p->next;
-        if( p->name.s ){
-            free(p->name.s);
-        }
-        free(p);
-        p=q;
-    }
-}
+struct olua_statement;
+struct olua_fetch_buffer;
 
+/* olua_decoder
+ *   push the value of a column at the row (not NULL) of the define arrays.
+ *   It is chosen for the type of the column when the arrays are made.
+ */
+typedef void (*olua_decoder)(
+    lua_State *lua ,
+    int stmt ,
+    struct olua_statement *statement ,
+    struct olua_fetch_buffer *fetch_buffer ,
+    ub4 row );
+
+/* One node per column. The nodes of a statement are an array of ncols in its
+ * arena, followed by the data buffer of each column (`size` bytes for each
+ * row of the fetch array) with the indicator and length arrays, and the
+ * name of the column.
+ */
 struct olua_fetch_buffer {
     ub2 type;
     ub2 size;
-    ub2 len;
-    sb2 ind;
+    ub2 *len;
+    sb2 *ind;
+    ub4 dtype;  /* descriptor type when the data buffer holds descriptors */
+    ub4 rows;   /* number of rows of the data buffer */
     char *name;
+    olua_decoder decode;
     union{
         dvoid *pointor;
         char *string;
         int  *integer;
         double *number;
     }u;
-    struct olua_fetch_buffer *next;
 };
 
 struct olua_fetch_buffer *olua_fetch_buffer_new(struct olua_fetch_buffer *self)
@@ -174,35 +399,66 @@ struct olua_fetch_buffer *olua_fetch_buffer_new(struct olua_fetch_buffer *self)
         return NULL;
     
     self->size = 0;
-    self->len = 0;
-    self->ind = 0;
+    self->len = NULL;
+    self->ind = NULL;
+    self->dtype = 0;
+    self->rows = 0;
     self->name = NULL;
     self->u.pointor = NULL;
-    self->next = NULL;
+    self->decode = NULL;
 
     return self;
 }
 
-static void olua_fetch_buffer_gc(struct olua_fetch_buffer *p)
-{
-    DEBUG( printf("ENTER: olua_fetch_buffer_gc(%p)\n",p ));
-    while( p != NULL ){
-        struct olua_fetch_buffer *q=p->next;
-        if( p->u.pointor != NULL )
-            free(p->u.pointor);
-        if( p->name != NULL )
-            free(p->name);
-        free(p);
-        p=q;
-    }
-    DEBUG( puts("LEAVE: olua_fetch_buffer_gc()"));
-}
+/* how olua_fetch hands out rows (the option `mode`) */
+enum { OLUA_MODE_TABLE , OLUA_MODE_LAZY , OLUA_MODE_ARRAY };
+static const char *const olua_modes[]={ "table" , "lazy" , "array" , NULL };
+
+/* how DATE and TIMESTAMP are returned (the option `date`) */
+enum { OLUA_DATE_STRING , OLUA_DATE_EPOCH , OLUA_DATE_TABLE };
+static const char *const olua_dates[]={ "string" , "epoch" , "table" , NULL };
+
+struct olua_connect;
 
 struct olua_statement {
+    struct olua_connect *conn;
+    OCIEnv   *envhp;
     OCIStmt  *stmthp;
     OCIError *errhp;
-    struct olua_bind_buffer  *bind_buffer;
+    struct olua_bind_buffer **bind_buffer; /* array of nbinds slots */
     struct olua_fetch_buffer *fetch_buffer;
+    int ncols;       /* number of nodes in fetch_buffer */
+    ub4 fetch_size;  /* rows per OCIStmtFetch2 (length of define arrays) */
+    ub4 fetch_rows;  /* rows held in the define arrays now */
+    ub4 fetch_index; /* next row to hand out from the define arrays */
+    int fetch_done;  /* the last OCIStmtFetch2 returned OCI_NO_DATA */
+    ub4 fetch_alloc; /* fetch_size the define arrays were allocated for */
+    int nbinds;      /* number of bind slots */
+    int bind_alloc;  /* length of the array bind_buffer */
+    int busy;        /* SELECT executed and not fetched to the end yet */
+    int cached;      /* owned by the statement cache of the connection */
+    int mode;        /* OLUA_MODE_xxx */
+    int reuse;       /* refill the member `row` instead of a new table */
+    int date;        /* OLUA_DATE_xxx */
+    int sync;        /* run by a C loop which can not yield */
+    int scrollable;  /* executed with OCI_STMT_SCROLLABLE_READONLY */
+    int refcursor;   /* REF CURSOR or implicit result: opened by the server */
+    int borrowed;    /* stmthp belongs to the parent (implicit result) */
+    struct olua_statement *parent; /* of the implicit result */
+    unsigned long executions; /* executions of the statement, and of the parent
+                                 when the implicit result was returned */
+    unsigned long generation; /* changes whenever define arrays are refilled */
+    size_t fetch_arena;  /* bytes of the arena of fetch_buffer */
+    lua_Alloc allocf;    /* allocator of the Lua state (NULL: malloc) */
+    void *allocud;
+    struct olua_counters counters;
+    unsigned long long run_ns;   /* time of the current execution and its fetches */
+    unsigned long long run_rows; /* rows fetched or processed by it */
+    int run_open;     /* the execution is not checked by olua_slowhook yet */
+    int executing;    /* olua_execute yielded and is called again */
+    int fetching;     /* olua_fetch_batch left a fetch pending */
+    unsigned long long call_start; /* olua_now at the start of the call traced */
+    char sql_id[14];  /* SQL_ID of the text for the option `trace` */
 };
 
 struct olua_statement *olua_statement_new(struct olua_statement *self)
@@ -210,13 +466,162 @@ struct olua_statement *olua_statement_new(struct olua_statement *self)
     if( self == NULL && (self = malloc( sizeof(struct olua_statement) ))==NULL ){
         return NULL;
     }
+    self->conn         = NULL;
+    self->envhp        = NULL;
     self->stmthp       = NULL;
     self->errhp        = NULL;
     self->bind_buffer  = NULL;
     self->fetch_buffer = NULL;
+    self->ncols        = 0;
+    self->fetch_size   = 1;
+    self->fetch_rows   = 0;
+    self->fetch_index  = 0;
+    self->fetch_done   = 0;
+    self->fetch_alloc  = 0;
+    self->nbinds       = 0;
+    self->bind_alloc   = 0;
+    self->busy         = 0;
+    self->cached       = 0;
+    self->mode         = OLUA_MODE_TABLE;
+    self->reuse        = 0;
+    self->date         = OLUA_DATE_STRING;
+    self->sync         = 0;
+    self->scrollable   = 0;
+    self->refcursor    = 0;
+    self->borrowed     = 0;
+    self->parent       = NULL;
+    self->executions   = 0;
+    self->generation   = 0;
+    self->fetch_arena  = 0;
+    self->allocf       = NULL;
+    self->allocud      = NULL;
+    memset( &self->counters , 0 , sizeof(self->counters) );
+    self->run_ns       = 0;
+    self->run_rows     = 0;
+    self->run_open     = 0;
+    self->executing    = 0;
+    self->fetching     = 0;
+    self->call_start   = 0;
+    self->sql_id[0]    = '\0';
     return self;
 }
 
+/* olua_run_start
+ *   start to measure an execution of the statement for the option `slow`.
+ */
+static void olua_run_start(struct olua_statement *statement)
+{
+    statement->run_ns   = 0;
+    statement->run_rows = 0;
+    statement->run_open = 1;
+}
+
+/* Memory of a statement (the arena of the define arrays and the bind
+ * slots) comes from the allocator of the Lua state, so that an embedding
+ * application can supply its own. MEMORY_TEST traces it same as malloc.
+ */
+static void *olua_alloc(struct olua_statement *statement,size_t size)
+{
+    void *p;
+
+    if( statement->allocf == NULL )
+        return malloc(size);
+    p = statement->allocf(statement->allocud,NULL,0,size);
+#ifdef MEMORY_TEST
+    fprintf(stderr,"ALLOC: %p\n",p);
+    fflush(stderr);
+#endif
+    return p;
+}
+
+static void olua_free(struct olua_statement *statement,void *p,size_t size)
+{
+    if( statement->allocf == NULL ){
+        free(p);
+        return;
+    }
+#ifdef MEMORY_TEST
+    fprintf(stderr,"FREE: %p\n",p);
+    fflush(stderr);
+#endif
+    statement->allocf(statement->allocud,p,size,0);
+}
+
+static void olua_bind_buffer_gc(struct olua_statement *statement)
+{
+    int i;
+
+    for( i=0 ; i < statement->nbinds ; i++ )
+        olua_free(statement,statement->bind_buffer[i],statement->bind_buffer[i]->alloc);
+    if( statement->bind_buffer != NULL )
+        olua_free(statement,statement->bind_buffer,
+            sizeof(struct olua_bind_buffer*) * statement->bind_alloc);
+    statement->bind_buffer = NULL;
+    statement->bind_alloc = 0;
+    statement->nbinds = 0;
+}
+
+/* olua_fetch_arena_free
+ *   free the descriptors of the nodes and the arena at once.
+ */
+static void olua_fetch_arena_free(
+    struct olua_statement *statement ,
+    struct olua_fetch_buffer *arena ,
+    int ncols ,
+    size_t size )
+{
+    int c;
+
+    DEBUG( printf("ENTER: olua_fetch_arena_free(%p)\n",arena ));
+    for( c=0 ; arena != NULL && c < ncols ; c++ ){
+        struct olua_fetch_buffer *p=&arena[c];
+
+        if( p->dtype != 0 && p->u.pointor != NULL ){
+            ub4 i;
+            for( i=0 ; i < p->rows ; i++ ){
+                dvoid *desc=((dvoid**)p->u.pointor)[i];
+                if( desc != NULL )
+                    OCIDescriptorFree( desc , p->dtype );
+            }
+        }
+    }
+    if( arena != NULL )
+        olua_free(statement,arena,size);
+    DEBUG( puts("LEAVE: olua_fetch_arena_free()"));
+}
+
+static void olua_fetch_buffer_gc(struct olua_statement *statement)
+{
+    olua_fetch_arena_free(statement,statement->fetch_buffer,statement->ncols,statement->fetch_arena);
+    statement->fetch_buffer = NULL;
+    statement->fetch_arena = 0;
+}
+
+static void olua_statement_free(struct olua_statement *statement)
+{
+    /* statement-handle */
+    if( statement->stmthp != NULL ){
+        DEBUG( printf("OCIHandleFree(%p)\n",statement->stmthp) );
+        /* implicit results are freed by OCI with the parent */
+        if( ! statement->borrowed )
+            OCIHandleFree( statement->stmthp , OCI_HTYPE_STMT );
+        statement->stmthp = NULL;
+    }
+    statement->executions++;
+    /* error handle */
+    if( statement->errhp != NULL ){
+        OCIHandleFree( statement->errhp , OCI_HTYPE_ERROR );
+        statement->errhp = NULL;
+    }
+
+    olua_bind_buffer_gc( statement );
+    olua_fetch_buffer_gc( statement );
+    statement->ncols = 0;
+    statement->fetch_alloc = 0;
+    statement->busy = 0;
+    statement->generation++;
+}
+
 /* lua-function: olua_statement_gc
  *  stack-in
  *    (+1) userdata-object for oci-handle
@@ -238,22 +643,7 @@ static int olua_statement_gc(lua_State *lua)
     }
 
     DEBUG( printf("ENTER: olua_statement_gc(%p)\n",statement) );
-    /* statement-handle */
-    if( statement->stmthp != NULL ){
-        DEBUG( printf("OCIHandleFree(%p)\n",statement->stmthp) );
-        OCIHandleFree( statement->stmthp , OCI_HTYPE_STMT );
-        statement->stmthp = NULL;
-    }
-    /* error handle */
-    if( statement->errhp != NULL ){
-        OCIHandleFree( statement->errhp , OCI_HTYPE_ERROR );
-        statement->errhp = NULL;
-    }
-
-    olua_bind_buffer_gc( statement->bind_buffer );
-    statement->bind_buffer = NULL;
-    olua_fetch_buffer_gc( statement->fetch_buffer );
-    statement->fetch_buffer = NULL;
+    olua_statement_free(statement);
     DEBUG( puts("LEAVE: olua_statement_gc()") );
     return 0;
 }
@@ -289,831 +679,6318 @@ static void *olua_tohandle(lua_State *lua,int index,const char *tname)
     return userdata;
 }
 
+/* olua_getoption
+ *   push the option `name` of the object at `index`: from its member
+ *   `execute_options` (the option-table of STMT:execute, for that execution
+ *   only), the object itself, or its member `connection` (the option-table
+ *   given to oluacle.new) when the object does not have it.
+ */
+static void olua_getoption(lua_State *lua,int index,const char *name)
+{
+    index = lua_absindex(lua,index);
+    lua_getfield(lua,index,"execute_options");
+    if( lua_istable(lua,-1) ){
+        lua_getfield(lua,-1,name);
+        lua_remove(lua,-2);
+        if( ! lua_isnil(lua,-1) )
+            return;
+    }
+    lua_pop(lua,1);
+    lua_getfield(lua,index,name);
+    if( lua_isnil(lua,-1) ){
+        lua_pop(lua,1);
+        lua_getfield(lua,index,"connection");
+        if( lua_istable(lua,-1) ){
+            lua_getfield(lua,-1,name);
+            lua_remove(lua,-2);
+        }
+    }
+}
+
+static lua_Integer olua_optinteger(lua_State *lua,int index,const char *name,lua_Integer def)
+{
+    lua_Integer value=def;
+
+    olua_getoption(lua,index,name);
+    if( lua_isnumber(lua,-1) )
+        value = lua_tointeger(lua,-1);
+    lua_pop(lua,1);
+    return value;
+}
+
+/* olua_checkenum
+ *   return the index of the value at `index` in the NULL-terminated list,
+ *   or `def` when it is nil. `name` is the option for the error-message.
+ */
+static int olua_checkenum(lua_State *lua,int index,const char *name,const char *const list[],int def)
+{
+    int value=def;
+
+    if( ! lua_isnoneornil(lua,index) ){
+        const char *s=lua_tostring(lua,index);
+
+        for( value=0 ; list[value] != NULL ; value++ ){
+            if( s != NULL && strcmp(list[value],s) == 0 )
+                break;
+        }
+        if( list[value] == NULL )
+            luaL_error(lua,"invalid value for option '%s': %s",name,s ? s : luaL_typename(lua,index));
+    }
+    return value;
+}
+
+/* olua_optenum
+ *   return the index of the option `name` in the NULL-terminated list,
+ *   or `def` when the option is not set.
+ */
+static int olua_optenum(lua_State *lua,int index,const char *name,const char *const list[],int def)
+{
+    int value;
+
+    olua_getoption(lua,index,name);
+    value = olua_checkenum(lua,-1,name,list,def);
+    lua_pop(lua,1);
+    return value;
+}
+
+/* An entry of the statement cache. The statement-object itself is kept
+ * in the user-value table of the connection's handle at the same index,
+ * so the cache never keeps a connection alive by itself.
+ */
+struct olua_stmtcache {
+    char *sql;
+    size_t sql_len;
+    struct olua_statement *statement;
+    unsigned long used; /* tick of the last hit, for LRU */
+};
+
 struct olua_connect {
     OCISvcCtx *svchp;
     OCIError  *errhp;
+    struct olua_stmtcache *cache;
+    int cache_size;
+    int cache_count;
+    unsigned long cache_tick;
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    unsigned long cache_evictions;
+    int pooled;  /* session from oluacle.pool: released, not logged off */
+    OCIServer *srvhp;
+    int async;        /* the option `async` */
+    int nonblocking;  /* OCI_ATTR_NONBLOCKING_MODE is on now */
+    int null_ref;     /* the option `null` in the registry (or LUA_NOREF) */
+    struct olua_counters counters;
+    unsigned long long slow_ns; /* the option `slow` */
+    int slow_ref;     /* the option `on_slow` in the registry (or LUA_NOREF) */
+    OCISession *sesshp; /* the session for module, action and the call time */
+    FILE *trace;      /* the option `trace` (or NULL) */
+    int trace_close;  /* trace was opened by the connection */
+    unsigned long trace_id; /* number of the connection in the lines of trace */
 };
 
-static int olua_disconnect(lua_State *lua)
+/* olua_slowhook
+ *   call the option `on_slow` of the connection as on_slow(SQL,SECONDS,ROWS)
+ *   when the last execution of the statement with its fetches took `slow`
+ *   seconds or more. It is checked once for each execution.
+ *   stack-in:
+ *     (stmt) statement-object
+ */
+static void olua_slowhook(lua_State *lua,int stmt,struct olua_statement *statement)
 {
-    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
-    sword status;
+    struct olua_connect *conn=statement->conn;
+
+    if( ! statement->run_open )
+        return;
+    statement->run_open = 0;
+    if( conn == NULL || conn->slow_ref == LUA_NOREF || statement->run_ns < conn->slow_ns )
+        return;
+    stmt = lua_absindex(lua,stmt);
+    lua_rawgeti(lua,LUA_REGISTRYINDEX,conn->slow_ref);
+    lua_getfield(lua,stmt,"sql");
+    lua_pushnumber(lua,(lua_Number)statement->run_ns / 1e9);
+    olua_pushint64(lua,(sb8)statement->run_rows);
+    lua_call(lua,3,0);
+}
 
-    DEBUG( puts("olua_disconnect()") );
-    
-    if( conn != NULL && conn->svchp != NULL ){
-        status = OCITransRollback(conn->svchp, conn->errhp, OCI_DEFAULT);
-        if( status != OCI_SUCCESS )
-            checkerr(lua,conn->errhp,status);
-        status = OCILogoff( conn->svchp , conn->errhp );
-        if( status != OCI_SUCCESS )
-            checkerr(lua,conn->errhp,status);
+static const ub4 olua_md5_k[64]={
+    0xd76aa478U , 0xe8c7b756U , 0x242070dbU , 0xc1bdceeeU ,
+    0xf57c0fafU , 0x4787c62aU , 0xa8304613U , 0xfd469501U ,
+    0x698098d8U , 0x8b44f7afU , 0xffff5bb1U , 0x895cd7beU ,
+    0x6b901122U , 0xfd987193U , 0xa679438eU , 0x49b40821U ,
+    0xf61e2562U , 0xc040b340U , 0x265e5a51U , 0xe9b6c7aaU ,
+    0xd62f105dU , 0x02441453U , 0xd8a1e681U , 0xe7d3fbc8U ,
+    0x21e1cde6U , 0xc33707d6U , 0xf4d50d87U , 0x455a14edU ,
+    0xa9e3e905U , 0xfcefa3f8U , 0x676f02d9U , 0x8d2a4c8aU ,
+    0xfffa3942U , 0x8771f681U , 0x6d9d6122U , 0xfde5380cU ,
+    0xa4beea44U , 0x4bdecfa9U , 0xf6bb4b60U , 0xbebfbc70U ,
+    0x289b7ec6U , 0xeaa127faU , 0xd4ef3085U , 0x04881d05U ,
+    0xd9d4d039U , 0xe6db99e5U , 0x1fa27cf8U , 0xc4ac5665U ,
+    0xf4292244U , 0x432aff97U , 0xab9423a7U , 0xfc93a039U ,
+    0x655b59c3U , 0x8f0ccc92U , 0xffeff47dU , 0x85845dd1U ,
+    0x6fa87e4fU , 0xfe2ce6e0U , 0xa3014314U , 0x4e0811a1U ,
+    0xf7537e82U , 0xbd3af235U , 0x2ad7d2bbU , 0xeb86d391U
+};
+static const unsigned char olua_md5_s[16]={ 7,12,17,22 , 5,9,14,20 , 4,11,16,23 , 6,10,15,21 };
 
-        OCIHandleFree( conn->errhp , OCI_HTYPE_ERROR );
-        conn->svchp = NULL;
-        conn->errhp = NULL;
+/* one block of 64 bytes of MD5 (RFC 1321) */
+static void olua_md5_block(ub4 h[4],const unsigned char *p)
+{
+    ub4 w[16],a=h[0],b=h[1],c=h[2],d=h[3],f,s;
+    int i,g;
+
+    for( i=0 ; i < 16 ; i++ )
+        w[i] = (ub4)p[i*4] | (ub4)p[i*4+1] << 8 | (ub4)p[i*4+2] << 16 | (ub4)p[i*4+3] << 24;
+    for( i=0 ; i < 64 ; i++ ){
+        switch( i / 16 ){
+        case 0:  f = (b & c) | (~b & d); g = i;             break;
+        case 1:  f = (d & b) | (~d & c); g = (5*i + 1) % 16; break;
+        case 2:  f = b ^ c ^ d;          g = (3*i + 5) % 16; break;
+        default: f = c ^ (b | ~d);       g = (7*i) % 16;     break;
+        }
+        f += a + olua_md5_k[i] + w[g];
+        s = olua_md5_s[(i/16)*4 + i%4];
+        a = d;
+        d = c;
+        c = b;
+        b += (f << s) | (f >> (32-s));
     }
-    return 0;
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
 }
 
-static int olua_rollback(lua_State *lua)
+/* olua_sqlid
+ *   the SQL_ID of the text as the server shows it in V$SQL: the last 64
+ *   bits of the MD5 of the text with its terminating NUL, in 13 digits
+ *   of base 32.
+ */
+static void olua_sqlid(const char *sql,char *sql_id)
 {
-    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
-    sword status;
+    static const char digits[]="0123456789abcdfghjkmnpqrstuvwxyz";
+    const unsigned char *p=(const unsigned char*)sql;
+    size_t rest=strlen(sql)+1;
+    unsigned long long bits=(unsigned long long)rest * 8;
+    unsigned long long id;
+    unsigned char tail[128];
+    ub4 h[4]={ 0x67452301U , 0xefcdab89U , 0x98badcfeU , 0x10325476U };
+    size_t n;
+    int i;
 
-    DEBUG( puts("ENTER olua_rollback()") );
-    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
-    status = OCITransRollback(conn->svchp, conn->errhp, OCI_DEFAULT);
-    if( status != OCI_SUCCESS )
-        checkerr(lua,conn->errhp,status);
-    DEBUG( puts("LEAVE olua_rollback()") );
-    return 0;
+    for( ; rest >= 64 ; rest -= 64 , p += 64 )
+        olua_md5_block(h,p);
+    memset(tail,0,sizeof(tail));
+    memcpy(tail,p,rest);
+    tail[rest] = 0x80;
+    n = rest < 56 ? 64 : 128;
+    for( i=0 ; i < 8 ; i++ )
+        tail[n-8+i] = (unsigned char)(bits >> (8*i));
+    olua_md5_block(h,tail);
+    if( n == 128 )
+        olua_md5_block(h,tail+64);
+
+    id = (unsigned long long)h[2] << 32 | h[3];
+    for( i=12 ; i >= 0 ; i-- ){
+        sql_id[i] = digits[id & 31];
+        id >>= 5;
+    }
+    sql_id[13] = '\0';
 }
 
-static int olua_commit(lua_State *lua)
+static unsigned long olua_trace_count; /* connections made with trace */
+
+/* olua_trace
+ *   write a line of JSON for the call on the statement into the option
+ *   `trace` of its connection. client_us is the elapsed time since
+ *   `start` and server_us is OCI_ATTR_CALL_TIME of the session, the time
+ *   the server spent for the last round-trip. `sql` is given for the
+ *   prepare, which makes no round-trip.
+ */
+static void olua_trace(struct olua_statement *statement,const char *call,
+                       unsigned long long start,unsigned long long rows,const char *sql)
+{
+    struct olua_connect *conn=statement->conn;
+    unsigned long long elapsed;
+    ub8 server=0;
+    FILE *fp;
+
+    if( conn == NULL || (fp = conn->trace) == NULL )
+        return;
+    elapsed = olua_now() - start;
+    fprintf(fp,"{\"time\":%.6f,\"conn\":%lu,\"call\":\"%s\",\"sql_id\":\"%s\",\"client_us\":%.0f",
+            olua_epoch() , conn->trace_id , call , statement->sql_id ,
+            (double)elapsed / 1e3 );
+    if( sql != NULL ){
+        fputs(",\"sql\":\"",fp);
+        for( ; *sql != '\0' ; sql++ ){
+            unsigned char c=(unsigned char)*sql;
+
+            if( c == '"' || c == '\\' )
+                fprintf(fp,"\\%c",c);
+            else if( c < 0x20 )
+                fprintf(fp,"\\u%04x",c);
+            else
+                fputc(c,fp);
+        }
+        fputc('"',fp);
+    }else{
+        OCIAttrGet( conn->sesshp , OCI_HTYPE_SESSION , (dvoid*)&server , NULL ,
+                    OCI_ATTR_CALL_TIME , conn->errhp );
+        fprintf(fp,",\"rows\":%.0f,\"server_us\":%.0f",(double)rows,(double)server);
+    }
+    fputs("}\n",fp);
+    fflush(fp);
+}
+
+/* olua_nonblocking
+ *   switch the non-blocking mode of the server handle. It is on only
+ *   while the calls which may yield are in progress, so that the other
+ *   calls on the connection block as usual.
+ */
+static void olua_nonblocking(lua_State *lua,struct olua_connect *conn,int on)
 {
-    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
     sword status;
 
-    DEBUG( puts("ENTER olua_commit()") );
-    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
-    status = OCITransCommit(conn->svchp, conn->errhp, OCI_DEFAULT);
+    if( ! conn->async || conn->nonblocking == on )
+        return;
+    /* setting OCI_ATTR_NONBLOCKING_MODE toggles the mode */
+    status = OCIAttrSet( conn->srvhp , OCI_HTYPE_SERVER , NULL , 0 ,
+                OCI_ATTR_NONBLOCKING_MODE , conn->errhp );
     if( status != OCI_SUCCESS )
         checkerr(lua,conn->errhp,status);
-    DEBUG( puts("LEAVE olua_commit()") );
-    return 0;
+    conn->nonblocking = on;
 }
 
-static int olua_exec(lua_State *lua);
-static int olua_prepare( lua_State *lua );
-static int olua_execute( lua_State *lua );
-static int olua_bind( lua_State *lua );
-static int olua_fetch( lua_State *lua );
-
-int olua_connect( lua_State *lua )
+static void olua_stmtcache_free(struct olua_connect *conn)
 {
-    sword status;
-    OCISvcCtx *svchp=NULL;
-    OCIError  *errhp=NULL;
-    const char *user   = luaL_checkstring(lua,1);
-    const char *passwd = luaL_checkstring(lua,2);
-    const char *dbname = NULL;
-    int opt;
-    OCIEnv *envhp=olua_envhp(lua);
-    struct olua_connect *conn=NULL;
+    int i;
 
-    if( lua_isstring(lua,3) ){
-        dbname = lua_tostring(lua,3);
-        opt=4;
-    }else{
-        dbname = "";
-        opt=3;
+    for(i=0 ; i < conn->cache_count ; i++ ){
+        olua_statement_free( conn->cache[i].statement );
+        conn->cache[i].statement->cached = 0;
+        free( conn->cache[i].sql );
     }
+    if( conn->cache != NULL )
+        free( conn->cache );
+    conn->cache = NULL;
+    conn->cache_count = 0;
+}
 
-    DEBUG( printf("olua_connect(\"%s\",\"%s\",\"%s\")\n" 
-                , user , passwd , dbname ) );
+/* olua_stmtcache_get
+ *   stack-in:
+ *     (handle) userdata of the connection
+ *   stack-out:
+ *     (+1) statement-object (on hit only)
+ *   return
+ *     1 on hit , 0 on miss
+ */
+static int olua_stmtcache_get(
+    lua_State *lua ,
+    int handle ,
+    const char *sql ,
+    size_t sql_len ,
+    int nbinds )
+{
+    struct olua_connect *conn=lua_touserdata(lua,handle);
+    int i;
 
-    putenv("NLS_DATE_FORMAT=YYYY/MM/DD HH24:MI:SS");
+    if( conn->cache_size <= 0 )
+        return 0;
 
-    /** error handle */
-    status = OCIHandleAlloc(envhp , (dvoid**)&errhp , OCI_HTYPE_ERROR , 0 , NULL );
-    if( status != OCI_SUCCESS ){
-        checkerr(lua,NULL,status);
-        abort();
+    for(i=0 ; i < conn->cache_count ; i++ ){
+        struct olua_stmtcache *p=&conn->cache[i];
+
+        /* a busy cursor is still iterated by someone. and binding fewer
+         * values than the last time would leave stale OCI binds. */
+        if( p->sql_len == sql_len && memcmp(p->sql,sql,sql_len)==0 &&
+            ! p->statement->busy && p->statement->nbinds <= nbinds )
+        {
+            p->used = ++conn->cache_tick;
+            conn->cache_hits++;
+            /* CONN:page may have raised an error while running it */
+            p->statement->sync = 0;
+
+            /* the bind slots are overwritten by the new values */
+            lua_getuservalue(lua,handle);
+            lua_rawgeti(lua,-1,i+1);
+            lua_remove(lua,-2);
+            lua_pushnil(lua);
+            lua_setfield(lua,-2,"lobs");
+            DEBUG( printf("stmtcache hit [%s]\n",sql) );
+            return 1;
+        }
     }
+    conn->cache_misses++;
+    return 0;
+}
 
-    /** login session */
-    status = OCILogon( envhp , errhp , &svchp , 
-              (CONST text *)user   , strlen(user) ,
-              (CONST text *)passwd , strlen(passwd) ,
-              (CONST text *)dbname , strlen(dbname) );
+/* olua_stmtcache_put
+ *   stack-in:
+ *     (handle) userdata of the connection
+ *     (-1)     statement-object prepared for `sql`
+ */
+static void olua_stmtcache_put(
+    lua_State *lua ,
+    int handle ,
+    const char *sql ,
+    size_t sql_len )
+{
+    struct olua_connect *conn=lua_touserdata(lua,handle);
+    struct olua_statement *statement;
+    struct olua_stmtcache *p;
+    char *sql_dup;
+    int i;
 
-    if( status != OCI_SUCCESS ){
-        checkerr(lua,errhp,status);
-        abort();
-    }
+    handle = lua_absindex(lua,handle);
+    if( conn->cache_size <= 0 )
+        return;
+    if( (sql_dup=malloc(sql_len+1)) == NULL )
+        return;
+    memcpy(sql_dup,sql,sql_len);
+    sql_dup[sql_len] = '\0';
 
-    if( svchp == NULL )
-        return 0;
-    
-    /* create instance */
-    if( lua_istable(lua,opt) ){
-        lua_pushvalue(lua,opt);
-    }else{
-        lua_newtable(lua);
-    }
+    lua_getfield(lua,-1,"handle");
+    statement = lua_touserdata(lua,-1);
+    lua_pop(lua,1);
 
-    /* member: handle */
-    if( (conn=lua_newuserdata(lua,sizeof(struct olua_connect))) == NULL){
-        OCILogoff( svchp , errhp );
-        return luaL_error(lua,"memory allocation error for userdata OCISvcCtx");
+    if( conn->cache == NULL ){
+        conn->cache = malloc( sizeof(struct olua_stmtcache) * conn->cache_size );
+        if( conn->cache == NULL ){
+            free( sql_dup );
+            return;
+        }
     }
-    conn->svchp = svchp;
-    conn->errhp = errhp; 
-
-    /* meta-table */
-    if( luaL_newmetatable(lua,TNAME_CONNECTION) ){
-        lua_pushcfunction(lua,olua_disconnect);
-        lua_setfield(lua,-2,"__gc");
-        lua_pushstring(lua,TNAME_CONNECTION);
-        lua_setfield(lua,-2,"__metatable");
+    if( conn->cache_count < conn->cache_size ){
+        i = conn->cache_count++;
+    }else{
+        /* evict the least recently used one. the garbage collector frees
+         * it when nobody else refers it. */
+        int j;
+        for( i=0,j=1 ; j < conn->cache_count ; j++ ){
+            if( conn->cache[j].used < conn->cache[i].used )
+                i = j;
+        }
+        DEBUG( printf("stmtcache evict [%s]\n",conn->cache[i].sql) );
+        conn->cache[i].statement->cached = 0;
+        free( conn->cache[i].sql );
+        conn->cache_evictions++;
     }
-    lua_setmetatable(lua,-2);
-    lua_setfield(lua,-2,"handle");
-
-    /* method: exec */
-    lua_pushcfunction(lua,olua_exec);
-    lua_setfield(lua,-2,"exec");
-
-    /* method: prepare */
-    lua_pushcfunction(lua,olua_prepare);
-    lua_setfield(lua,-2,"prepare");
+    p = &conn->cache[i];
+    p->sql = sql_dup;
+    p->sql_len = sql_len;
+    p->statement = statement;
+    p->used = ++conn->cache_tick;
+    statement->cached = 1;
+
+    lua_getuservalue(lua,handle);
+    lua_pushvalue(lua,-2);
+    lua_rawseti(lua,-2,i+1);
+    lua_pop(lua,1);
+}
 
-    /* method: commit */
-    lua_pushcfunction(lua,olua_commit);
-    lua_setfield(lua,-2,"commit");
+/* lua-function: olua_cachestats
+ *  stack-in
+ *    (+1) connection
+ *  return
+ *    (+1) table { size , count , hits , misses , evictions }
+ */
+static int olua_cachestats(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
 
-    /* method: rollback */
-    lua_pushcfunction(lua,olua_rollback);
-    lua_setfield(lua,-2,"rollback");
+    lua_createtable(lua,0,5);
+    lua_pushinteger(lua,conn->cache_size);
+    lua_setfield(lua,-2,"size");
+    lua_pushinteger(lua,conn->cache_count);
+    lua_setfield(lua,-2,"count");
+    lua_pushnumber(lua,(lua_Number)conn->cache_hits);
+    lua_setfield(lua,-2,"hits");
+    lua_pushnumber(lua,(lua_Number)conn->cache_misses);
+    lua_setfield(lua,-2,"misses");
+    lua_pushnumber(lua,(lua_Number)conn->cache_evictions);
+    lua_setfield(lua,-2,"evictions");
+    return 1;
+}
 
-    /* method: disconnect */
-    lua_pushcfunction(lua,olua_disconnect);
-    lua_setfield(lua,-2,"disconnect");
+/* lua-function: olua_connection_stats
+ *  stack-in
+ *    (+1) connection
+ *  return
+ *    (+1) table of the counters of the statements of the connection
+ */
+static int olua_connection_stats(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
 
-    /* method: logoff */
-    lua_pushcfunction(lua,olua_disconnect);
-    lua_setfield(lua,-2,"logoff");
+    olua_pushcounters(lua,&conn->counters);
+    return 1;
+}
 
-    /* method: close */
-    lua_pushcfunction(lua,olua_disconnect);
-    lua_setfield(lua,-2,"close");
+/* lua-function: olua_statement_stats
+ *  stack-in
+ *    (+1) statement-object
+ *  return
+ *    (+1) table of the counters of the statement
+ */
+static int olua_statement_stats(lua_State *lua)
+{
+    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
 
-    DEBUG( puts("successfully return 1") );
+    olua_pushcounters(lua,&statement->counters);
     return 1;
 }
 
+static int olua_disconnect(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+    sword status;
 
-/** olua_prepare
- * stack-in:
- *   (+1) connection.
- *   (+2) sql string
- * stack-out (success)
- *   (+1) statement-handle
- */
-static int olua_prepare( lua_State *lua )
+    DEBUG( puts("olua_disconnect()") );
+    
+    if( conn != NULL && conn->svchp != NULL ){
+        if( conn->nonblocking ){
+            /* a call left pending by a coroutine never resumed */
+            OCIBreak( conn->svchp , conn->errhp );
+            OCIReset( conn->svchp , conn->errhp );
+            olua_nonblocking(lua,conn,0);
+        }
+        olua_stmtcache_free(conn);
+        status = OCITransRollback(conn->svchp, conn->errhp, OCI_DEFAULT);
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+        if( conn->pooled )
+            status = OCISessionRelease( conn->svchp , conn->errhp , NULL , 0 , OCI_DEFAULT );
+        else
+            status = OCILogoff( conn->svchp , conn->errhp );
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+
+        OCIHandleFree( conn->errhp , OCI_HTYPE_ERROR );
+        conn->svchp = NULL;
+        conn->errhp = NULL;
+        conn->sesshp = NULL;
+    }
+    if( conn != NULL && conn->null_ref != LUA_NOREF ){
+        luaL_unref(lua,LUA_REGISTRYINDEX,conn->null_ref);
+        conn->null_ref = LUA_NOREF;
+    }
+    if( conn != NULL && conn->slow_ref != LUA_NOREF ){
+        luaL_unref(lua,LUA_REGISTRYINDEX,conn->slow_ref);
+        conn->slow_ref = LUA_NOREF;
+    }
+    if( conn != NULL && conn->trace != NULL ){
+        if( conn->trace_close )
+            fclose(conn->trace);
+        conn->trace = NULL;
+    }
+    return 0;
+}
+
+static int olua_rollback(lua_State *lua)
 {
-    struct olua_statement *statement=NULL;
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
     sword status;
-    ub4 prefetch = 0;
-    OCIEnv *envhp = olua_envhp(lua);
 
-    const char *sql = luaL_checkstring(lua,2);
-    (void)olua_tohandle(lua,1,TNAME_CONNECTION);
+    DEBUG( puts("ENTER olua_rollback()") );
+    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
+    status = OCITransRollback(conn->svchp, conn->errhp, OCI_DEFAULT);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,conn->errhp,status);
+    DEBUG( puts("LEAVE olua_rollback()") );
+    return 0;
+}
 
-    DEBUG( puts("ENTER: olua_prepare()"));
+static int olua_commit(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+    sword status;
 
-    /*** new statement object ***/
-    lua_newtable(lua);
-    statement = olua_statement_new( lua_newuserdata(lua,sizeof(struct olua_statement)));
-    assert( statement != NULL );
+    DEBUG( puts("ENTER olua_commit()") );
+    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
+    status = OCITransCommit(conn->svchp, conn->errhp, OCI_DEFAULT);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,conn->errhp,status);
+    DEBUG( puts("LEAVE olua_commit()") );
+    return 0;
+}
 
-    OCIHandleAlloc(envhp , (dvoid**)&statement->errhp , OCI_HTYPE_ERROR , 0 , NULL );
+/* A LOB value: a copy of the locator fetched (or a temporary LOB made by
+ * CONN:lob), read and written in chunks so that the whole value never
+ * has to be one Lua string. Its user-value is the connection's handle.
+ */
+struct olua_lob {
+    OCILobLocator *locator;
+    struct olua_connect *conn;
+    ub1 type;       /* SQLT_CLOB or SQLT_BLOB */
+    ub1 csfrm;      /* SQLCS_IMPLICIT or SQLCS_NCHAR (NCLOB) */
+    int temporary;
+    oraub8 offset;  /* next position to read or write (1-origin),
+                     * characters for CLOB and bytes for BLOB */
+    ub4 chunk;      /* OCILobGetChunkSize, 0 until it is asked */
+};
 
-    if( luaL_newmetatable(lua,TNAME_STATEMENT) ){
-        /* destructor */
-        lua_pushcfunction(lua,olua_statement_gc); /* destructor's func */
-        lua_setfield(lua,-2,"__gc"); /* assign destructor to meta table */
+/* bytes of the buffer for one character of CLOB */
+#define OLUA_LOB_MAXCHARSIZE 4
 
-        lua_pushstring(lua,TNAME_STATEMENT);
-        lua_setfield(lua,-2,"__metatable");
-    }
-    lua_setmetatable(lua,-2); /* assign metatable to user-object */
-    lua_setfield(lua,-2,"handle");  /* assign user-object to instance */
+static struct olua_lob *olua_lob_check(lua_State *lua,int index)
+{
+    struct olua_lob *lob=luaL_checkudata(lua,index,TNAME_LOB);
 
-    DEBUG( puts("CALL: OCIHandleAlloc") );
-    status = OCIHandleAlloc(
-        envhp ,
-        (dvoid**)&statement->stmthp ,
-        OCI_HTYPE_STMT  ,
-        0 ,
-        NULL );
-    DEBUG( puts("EXIT: OCIHandleAlloc") );
+    if( lob->locator == NULL )
+        luaL_error(lua,"the lob has been freed");
+    if( lob->conn->svchp == NULL )
+        luaL_error(lua,"connection has been closed.");
+    return lob;
+}
 
-    if( status != OCI_SUCCESS ){
-        checkerr(lua,statement->errhp,status);
-        abort();
+/* lua-function: olua_lob_gc
+ *  stack-in
+ *    (+1) lob
+ *  return
+ *    nothing
+ */
+static int olua_lob_gc(lua_State *lua)
+{
+    struct olua_lob *lob=luaL_checkudata(lua,1,TNAME_LOB);
+
+    DEBUG( printf("olua_lob_gc(%p)\n",lob->locator) );
+    if( lob->locator != NULL ){
+        if( lob->temporary && lob->conn->svchp != NULL )
+            OCILobFreeTemporary( lob->conn->svchp , lob->conn->errhp , lob->locator );
+        OCIDescriptorFree( lob->locator , OCI_DTYPE_LOB );
+        lob->locator = NULL;
     }
+    return 0;
+}
 
-    status = OCIAttrSet(statement->stmthp, OCI_HTYPE_STMT,
-		(dvoid *)&prefetch, (ub4)0, (ub4)OCI_ATTR_PREFETCH_ROWS,
-		statement->errhp);
-
-    if( status != OCI_SUCCESS ){
-        checkerr(lua,statement->errhp,status);
-        abort();
+static ub4 olua_lob_chunksize(lua_State *lua,struct olua_lob *lob)
+{
+    if( lob->chunk == 0 ){
+        sword status=OCILobGetChunkSize( lob->conn->svchp , lob->conn->errhp ,
+                        lob->locator , &lob->chunk );
+        if( status != OCI_SUCCESS )
+            checkerr(lua,lob->conn->errhp,status);
+        if( lob->chunk == 0 )
+            lob->chunk = 8192;
     }
+    return lob->chunk;
+}
 
-    DEBUG( printf("SQL=[%s]\n",sql) );
-    status = OCIStmtPrepare(
-        statement->stmthp , statement->errhp, (CONST text*)sql , (ub4)strlen(sql) ,
-        (ub4)OCI_NTV_SYNTAX , (ub4)OCI_DEFAULT );
+/* lua-function: olua_lob_read
+ *  stack-in
+ *    (+1) lob
+ *    (+2) amount to read (optional: the chunk size of the lob)
+ *    (+3) offset to read from (optional: where the last read ended)
+ *  return
+ *    (+1) string, or nil at the end of the lob
+ */
+static int olua_lob_read(lua_State *lua)
+{
+    struct olua_lob *lob=olua_lob_check(lua,1);
+    lua_Integer amount=luaL_optinteger(lua,2,0);
+    oraub8 byte_amt=0 , char_amt=0 , bufl;
+    luaL_Buffer buffer;
+    char *p;
+    sword status;
 
-    DEBUG( printf("OCIStmtPrepare()=%d\n",status));
+    if( amount <= 0 )
+        amount = olua_lob_chunksize(lua,lob);
+    if( ! lua_isnoneornil(lua,3) )
+        lob->offset = (oraub8)luaL_checkinteger(lua,3);
 
-    if( status != OCI_SUCCESS ){
-        checkerr(lua,statement->errhp,status);
-        abort();
+    if( lob->type == SQLT_CLOB ){
+        char_amt = (oraub8)amount;
+        bufl = char_amt * OLUA_LOB_MAXCHARSIZE;
+    }else{
+        byte_amt = (oraub8)amount;
+        bufl = byte_amt;
     }
-    DEBUG( printf("Statement-handle=%p\n",statement->stmthp) );
-    DEBUG( puts("LEAVE: olua_prepare(success)"));
+    p = luaL_buffinitsize(lua,&buffer,(size_t)bufl);
 
-    /* stack:
-     *   1:connection 
-     *   2:sql
-     * ------
-     *   3:object
-     *   4:meta-table (DEL)
-     *   5:key (DEL)
-     *   6:value (DEL)
-     */
-
-    /* method: bind */
-    lua_pushcfunction(lua,olua_bind);
-    lua_setfield(lua,-2,"bind");
+    status = OCILobRead2( lob->conn->svchp , lob->conn->errhp , lob->locator ,
+                &byte_amt , &char_amt , lob->offset , p , bufl ,
+                OCI_ONE_PIECE , NULL , NULL , 0 , lob->csfrm );
+    if( status == OCI_NO_DATA || (status == OCI_SUCCESS && byte_amt == 0) ){
+        lua_pushnil(lua);
+        return 1;
+    }
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,lob->conn->errhp,status);
 
-    /* method: execute */
-    lua_pushcfunction(lua,olua_execute);
-    lua_setfield(lua,-2,"execute");
+    DEBUG( printf("OCILobRead2: offset=%lu bytes=%lu chars=%lu\n",
+                (unsigned long)lob->offset,(unsigned long)byte_amt,(unsigned long)char_amt) );
+    lob->offset += (lob->type == SQLT_CLOB ? char_amt : byte_amt);
+    luaL_pushresultsize(&buffer,(size_t)byte_amt);
+    return 1;
+}
 
-    /* method: fetch */
-    lua_pushcfunction(lua,olua_fetch);
-    lua_setfield(lua,-2,"fetch");
+/* lua-function: olua_lob_next
+ *   iterator made by lob:chunks()
+ *  upvalue
+ *    (1) amount to read at a time
+ */
+static int olua_lob_next(lua_State *lua)
+{
+    lua_settop(lua,1);
+    lua_pushvalue(lua,lua_upvalueindex(1));
+    return olua_lob_read(lua);
+}
 
-    /* member: connection */
+/* lua-function: olua_lob_chunks
+ *  stack-in
+ *    (+1) lob
+ *    (+2) amount to read at a time (optional: the chunk size of the lob)
+ *  return
+ *    (+1) iterator
+ *    (+2) lob
+ */
+static int olua_lob_chunks(lua_State *lua)
+{
+    struct olua_lob *lob=olua_lob_check(lua,1);
+    lua_Integer amount=luaL_optinteger(lua,2,0);
+
+    if( amount <= 0 )
+        amount = olua_lob_chunksize(lua,lob);
+    lob->offset = 1;
+    lua_pushinteger(lua,amount);
+    lua_pushcclosure(lua,olua_lob_next,1);
     lua_pushvalue(lua,1);
-    lua_setfield(lua,-2,"connection");
+    return 2;
+}
 
-    /* member: sql-string */
-    lua_pushvalue(lua,2);
-    lua_setfield(lua,-2,"sql");
+/* lua-function: olua_lob_size
+ *  return
+ *    (+1) length of the lob (characters for CLOB, bytes for BLOB)
+ */
+static int olua_lob_size(lua_State *lua)
+{
+    struct olua_lob *lob=olua_lob_check(lua,1);
+    oraub8 length=0;
+    sword status;
 
+    status = OCILobGetLength2( lob->conn->svchp , lob->conn->errhp , lob->locator , &length );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,lob->conn->errhp,status);
+    olua_pushint64(lua,(sb8)length);
     return 1;
 }
 
-/*
+/* lua-function: olua_lob_trim
+ *  stack-in
+ *    (+1) lob
+ *    (+2) new length (optional: 0)
+ */
+static int olua_lob_trim(lua_State *lua)
+{
+    struct olua_lob *lob=olua_lob_check(lua,1);
+    oraub8 length=(oraub8)luaL_optinteger(lua,2,0);
+    sword status;
+
+    status = OCILobTrim2( lob->conn->svchp , lob->conn->errhp , lob->locator , length );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,lob->conn->errhp,status);
+    if( lob->offset > length+1 )
+        lob->offset = length+1;
+    return 0;
+}
+
+/* olua_lob_pull
+ *   call `source:read(size)` and leave the result on the top.
+ * return
+ *   0 on success, or the status of lua_pcall with the message on the top.
+ */
+static int olua_lob_pull(lua_State *lua,int source,ub4 size)
+{
+    lua_getfield(lua,source,"read");
+    lua_pushvalue(lua,source);
+    lua_pushinteger(lua,size);
+    return lua_pcall(lua,2,1,0);
+}
+
+/* lua-function: olua_lob_write
+ *  stack-in
+ *    (+1) lob
+ *    (+2) string, or an object with the method `read` like a file-handle
+ *    (+3) offset to write at (optional: where the last write ended)
+ *  return
+ *    (+1) amount written (characters for CLOB, bytes for BLOB)
+ *
+ * A string is written at once. From a file-handle, the data is read
+ * with `read(chunksize)` and sent by OCILobWrite2 piece by piece.
+ */
+static int olua_lob_write(lua_State *lua)
+{
+    struct olua_lob *lob=olua_lob_check(lua,1);
+    OCISvcCtx *svchp=lob->conn->svchp;
+    OCIError *errhp=lob->conn->errhp;
+    oraub8 byte_amt=0 , char_amt=0;
+    const char *data;
+    size_t len;
+    ub1 piece;
+    ub4 size;
+    sword status;
+
+    if( ! lua_isnoneornil(lua,3) )
+        lob->offset = (oraub8)luaL_checkinteger(lua,3);
+    lua_settop(lua,2);
+
+    if( lua_type(lua,2) == LUA_TSTRING ){
+        data = lua_tolstring(lua,2,&len);
+        if( len == 0 ){
+            lua_pushinteger(lua,0);
+            return 1;
+        }
+        byte_amt = len;
+        status = OCILobWrite2( svchp , errhp , lob->locator ,
+                    &byte_amt , &char_amt , lob->offset , (dvoid*)data , len ,
+                    OCI_ONE_PIECE , NULL , NULL , 0 , lob->csfrm );
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,errhp,status);
+    }else{
+        luaL_argcheck(lua,! lua_isnil(lua,2),2,"string or file-handle expected");
+        size = olua_lob_chunksize(lua,lob);
+        if( lob->type == SQLT_CLOB )
+            size *= OLUA_LOB_MAXCHARSIZE;
+
+        /* stack: 1:lob 2:source 3:piece to send 4:next piece.
+         * a piece is sent after the next one is read to know the last. */
+        if( olua_lob_pull(lua,2,size) != 0 )
+            return lua_error(lua);
+        if( lua_type(lua,3) != LUA_TSTRING || lua_rawlen(lua,3) == 0 ){
+            lua_pushinteger(lua,0);
+            return 1;
+        }
+        piece = OCI_FIRST_PIECE;
+        for(;;){
+            int last;
+
+            if( olua_lob_pull(lua,2,size) != 0 ){
+                /* a write in progress can only be cancelled */
+                if( piece != OCI_FIRST_PIECE ){
+                    OCIBreak( svchp , errhp );
+                    OCIReset( svchp , errhp );
+                }
+                return lua_error(lua);
+            }
+            last = ( lua_type(lua,4) != LUA_TSTRING || lua_rawlen(lua,4) == 0 );
+            data = lua_tolstring(lua,3,&len);
+            if( last ){
+                if( piece == OCI_FIRST_PIECE ){
+                    piece = OCI_ONE_PIECE;
+                    byte_amt = len;
+                }else{
+                    piece = OCI_LAST_PIECE;
+                }
+            }
+            DEBUG( printf("OCILobWrite2: piece=%d len=%lu\n",piece,(unsigned long)len) );
+            status = OCILobWrite2( svchp , errhp , lob->locator ,
+                        &byte_amt , &char_amt , lob->offset , (dvoid*)data , len ,
+                        piece , NULL , NULL , 0 , lob->csfrm );
+            if( last )
+                break;
+            if( status != OCI_NEED_DATA ){
+                if( piece != OCI_FIRST_PIECE ){
+                    OCIBreak( svchp , errhp );
+                    OCIReset( svchp , errhp );
+                }
+                return checkerr(lua,errhp,status == OCI_SUCCESS ? OCI_ERROR : status);
+            }
+            piece = OCI_NEXT_PIECE;
+            lua_replace(lua,3);
+        }
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,errhp,status);
+    }
+    if( lob->type == SQLT_CLOB ){
+        lob->offset += char_amt;
+        olua_pushint64(lua,(sb8)char_amt);
+    }else{
+        lob->offset += byte_amt;
+        olua_pushint64(lua,(sb8)byte_amt);
+    }
+    return 1;
+}
+
+/* olua_lob_new
+ *   push a new lob-object holding a copy of `locator`, or a new
+ *   temporary LOB when `locator` is NULL.
+ *   stack-in:
+ *     (handle) userdata of the connection
+ */
+static struct olua_lob *olua_lob_new(
+    lua_State *lua ,
+    int handle ,
+    OCILobLocator *locator ,
+    ub1 type )
+{
+    struct olua_connect *conn=lua_touserdata(lua,handle);
+    struct olua_lob *lob;
+    sword status;
+
+    handle = lua_absindex(lua,handle);
+    lob = lua_newuserdata(lua,sizeof(struct olua_lob));
+    lob->locator = NULL;
+    lob->conn = conn;
+    lob->type = type;
+    lob->csfrm = SQLCS_IMPLICIT;
+    lob->temporary = 0;
+    lob->offset = 1;
+    lob->chunk = 0;
+
+    if( luaL_newmetatable(lua,TNAME_LOB) ){
+        luaL_Reg methods[]={
+            { "read" , olua_lob_read } ,
+            { "chunks" , olua_lob_chunks } ,
+            { "size" , olua_lob_size } ,
+            { "write" , olua_lob_write } ,
+            { "trim" , olua_lob_trim } ,
+            { "free" , olua_lob_gc } ,
+            { NULL , NULL } ,
+        };
+        lua_pushcfunction(lua,olua_lob_gc);
+        lua_setfield(lua,-2,"__gc");
+        lua_pushstring(lua,TNAME_LOB);
+        lua_setfield(lua,-2,"__metatable");
+        lua_newtable(lua);
+        luaL_setfuncs(lua,methods,0);
+        lua_setfield(lua,-2,"__index");
+    }
+    lua_setmetatable(lua,-2);
+    lua_pushvalue(lua,handle);
+    lua_setuservalue(lua,-2);
+
+    if( conn->svchp == NULL )
+        luaL_error(lua,"connection has been closed.");
+    status = OCIDescriptorAlloc( olua_envhp(lua) , (dvoid**)&lob->locator ,
+                OCI_DTYPE_LOB , 0 , NULL );
+    if( status != OCI_SUCCESS ){
+        lob->locator = NULL;
+        luaL_error(lua,"olua_lob_new(): descriptor allocation error");
+    }
+    if( locator != NULL ){
+        status = OCILobLocatorAssign( conn->svchp , conn->errhp , locator , &lob->locator );
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+        status = OCILobCharSetForm( olua_envhp(lua) , conn->errhp , lob->locator , &lob->csfrm );
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+    }else{
+        status = OCILobCreateTemporary( conn->svchp , conn->errhp , lob->locator ,
+                    0 , SQLCS_IMPLICIT ,
+                    type == SQLT_CLOB ? OCI_TEMP_CLOB : OCI_TEMP_BLOB ,
+                    FALSE , OCI_DURATION_SESSION );
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+        lob->temporary = 1;
+    }
+    return lob;
+}
+
+/* lua-function: olua_newlob
+ *  stack-in
+ *    (+1) connection
+ *    (+2) "clob" or "blob" (optional: "clob")
+ *  return
+ *    (+1) lob-object of a temporary LOB to bind
+ */
+static int olua_newlob(lua_State *lua)
+{
+    static const char *const types[]={ "clob" , "blob" , NULL };
+    int type;
+
+    (void)olua_tohandle(lua,1,TNAME_CONNECTION);
+    type = luaL_checkoption(lua,2,"clob",types);
+    lua_getfield(lua,1,"handle");
+    olua_lob_new(lua,-1,NULL,type == 0 ? SQLT_CLOB : SQLT_BLOB);
+    return 1;
+}
+
+static FILE *olua_tofile(lua_State *lua,int index,const char *mode,int *close,const char *who);
+
+/* olua_setinfo
+ *   set the fields module, action, client_id and dbop of the table at
+ *   `index` on the session. They go to the server with the next
+ *   round-trip and are seen in V$SESSION, ASH and the SQL monitor.
+ */
+static void olua_setinfo(lua_State *lua,struct olua_connect *conn,int index)
+{
+    static const char *const names[]={ "module" , "action" , "client_id" , "dbop" };
+    static const ub4 attrs[]={ OCI_ATTR_MODULE , OCI_ATTR_ACTION ,
+                               OCI_ATTR_CLIENT_IDENTIFIER , OCI_ATTR_DBOP };
+    const char *value;
+    size_t len;
+    sword status;
+    int i;
+
+    index = lua_absindex(lua,index);
+    for( i=0 ; i < 4 ; i++ ){
+        lua_getfield(lua,index,names[i]);
+        if( lua_isstring(lua,-1) ){
+            value = lua_tolstring(lua,-1,&len);
+            status = OCIAttrSet( conn->sesshp , OCI_HTYPE_SESSION , (dvoid*)value ,
+                        (ub4)len , attrs[i] , conn->errhp );
+            if( status != OCI_SUCCESS )
+                checkerr(lua,conn->errhp,status);
+        }
+        lua_pop(lua,1);
+    }
+}
+
+/* olua_opentrace
+ *   open the option `trace` of the table at `index`, which is a filename
+ *   or an opened file-handle, or else the file named by the environment
+ *   variable OLUACLE_TRACE. The server time of each call is collected
+ *   while tracing.
+ */
+static void olua_opentrace(lua_State *lua,struct olua_connect *conn,int index)
+{
+    const char *env;
+    boolean on=TRUE;
+    sword status;
+
+    lua_getfield(lua,index,"trace");
+    if( lua_isnil(lua,-1) && (env = getenv("OLUACLE_TRACE")) != NULL && *env != '\0' ){
+        lua_pop(lua,1);
+        lua_pushstring(lua,env);
+    }
+    if( lua_toboolean(lua,-1) )
+        conn->trace = olua_tofile(lua,-1,"a",&conn->trace_close,"trace");
+    lua_pop(lua,1);
+    if( conn->trace == NULL )
+        return;
+    conn->trace_id = ++olua_trace_count;
+    status = OCIAttrSet( conn->sesshp , OCI_HTYPE_SESSION , (dvoid*)&on , 0 ,
+                OCI_ATTR_COLLECT_CALL_TIME , conn->errhp );
+    if( status != OCI_SUCCESS )
+        checkerr(lua,conn->errhp,status);
+}
+
+/* CONN:setinfo{ module=.. , action=.. , client_id=.. , dbop=.. } */
+static int olua_connection_setinfo(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+
+    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
+    luaL_checktype(lua,2,LUA_TTABLE);
+    olua_setinfo(lua,conn,2);
+    return 0;
+}
+
+static int olua_exec(lua_State *lua);
+static int olua_page(lua_State *lua);
+static int olua_execmany(lua_State *lua);
+static int olua_export(lua_State *lua);
+static int olua_load(lua_State *lua);
+static int olua_directpath(lua_State *lua);
+static int olua_prepare( lua_State *lua );
+static int olua_cursor( lua_State *lua );
+static int olua_execute( lua_State *lua );
+static int olua_bind( lua_State *lua );
+static int olua_statement_execute( lua_State *lua );
+static int olua_fetch( lua_State *lua );
+static int olua_fetchcolumns( lua_State *lua );
+static int olua_fetch_absolute( lua_State *lua );
+static int olua_fetch_relative( lua_State *lua );
+static int olua_connection_new(lua_State *lua,OCISvcCtx *svchp,OCIError *errhp,int pooled);
+
+int olua_connect( lua_State *lua )
+{
+    sword status;
+    OCISvcCtx *svchp=NULL;
+    OCIError  *errhp=NULL;
+    const char *user   = luaL_checkstring(lua,1);
+    const char *passwd = luaL_checkstring(lua,2);
+    const char *dbname = NULL;
+    int opt;
+    OCIEnv *envhp=olua_envhp(lua);
+
+    if( lua_isstring(lua,3) ){
+        dbname = lua_tostring(lua,3);
+        opt=4;
+    }else{
+        dbname = "";
+        opt=3;
+    }
+
+    DEBUG( printf("olua_connect(\"%s\",\"%s\",\"%s\")\n" 
+                , user , passwd , dbname ) );
+
+    putenv("NLS_DATE_FORMAT=YYYY/MM/DD HH24:MI:SS");
+
+    /** error handle */
+    status = OCIHandleAlloc(envhp , (dvoid**)&errhp , OCI_HTYPE_ERROR , 0 , NULL );
+    if( status != OCI_SUCCESS ){
+        checkerr(lua,NULL,status);
+        abort();
+    }
+
+    /** login session */
+    status = OCILogon( envhp , errhp , &svchp , 
+              (CONST text *)user   , strlen(user) ,
+              (CONST text *)passwd , strlen(passwd) ,
+              (CONST text *)dbname , strlen(dbname) );
+
+    if( status != OCI_SUCCESS ){
+        checkerr(lua,errhp,status);
+        abort();
+    }
+
+    if( svchp == NULL )
+        return 0;
+    
+    /* create instance */
+    if( lua_istable(lua,opt) ){
+        lua_pushvalue(lua,opt);
+    }else{
+        lua_newtable(lua);
+    }
+    return olua_connection_new(lua,svchp,errhp,0);
+}
+
+/* olua_connection_new
+ *   make the table on the top into a connection-object of the session.
+ *   stack-in:
+ *     (-1) option-table given to oluacle.new (the instance)
+ *   stack-out:
+ *     (-1) connection-object
+ */
+static int olua_connection_new(lua_State *lua,OCISvcCtx *svchp,OCIError *errhp,int pooled)
+{
+    struct olua_connect *conn=NULL;
+    sword status;
+
+    /* member: handle */
+    if( (conn=lua_newuserdata(lua,sizeof(struct olua_connect))) == NULL){
+        OCILogoff( svchp , errhp );
+        return luaL_error(lua,"memory allocation error for userdata OCISvcCtx");
+    }
+    conn->svchp = svchp;
+    conn->errhp = errhp; 
+    conn->cache = NULL;
+    conn->cache_size = (int)olua_optinteger(lua,-2,"stmtcache",OLUA_DEFAULT_STMTCACHE);
+    conn->cache_count = 0;
+    conn->cache_tick = 0;
+    conn->cache_hits = 0;
+    conn->cache_misses = 0;
+    conn->cache_evictions = 0;
+    conn->pooled = pooled;
+    conn->srvhp = NULL;
+    conn->nonblocking = 0;
+    olua_getoption(lua,-2,"async");
+    conn->async = lua_toboolean(lua,-1);
+    lua_pop(lua,1);
+    conn->null_ref = LUA_NOREF;
+    olua_getoption(lua,-2,"null");
+    if( lua_isnil(lua,-1) )
+        lua_pop(lua,1);
+    else
+        conn->null_ref = luaL_ref(lua,LUA_REGISTRYINDEX);
+    memset( &conn->counters , 0 , sizeof(conn->counters) );
+    olua_getoption(lua,-2,"slow");
+    conn->slow_ns = (unsigned long long)( lua_tonumber(lua,-1) * 1e9 );
+    lua_pop(lua,1);
+    conn->slow_ref = LUA_NOREF;
+    olua_getoption(lua,-2,"on_slow");
+    if( lua_isfunction(lua,-1) )
+        conn->slow_ref = luaL_ref(lua,LUA_REGISTRYINDEX);
+    else
+        lua_pop(lua,1);
+    conn->sesshp = NULL;
+    conn->trace = NULL;
+    conn->trace_close = 0;
+    conn->trace_id = 0;
+    if( conn->async ){
+        status = OCIAttrGet( svchp , OCI_HTYPE_SVCCTX , (dvoid*)&conn->srvhp ,
+                        NULL , OCI_ATTR_SERVER , errhp );
+        if( status != OCI_SUCCESS ){
+            conn->async = 0;
+            checkerr(lua,errhp,status);
+        }
+    }
+
+    /* user-value: statement-objects in the statement cache */
+    lua_newtable(lua);
+    lua_setuservalue(lua,-2);
+
+    /* meta-table */
+    if( luaL_newmetatable(lua,TNAME_CONNECTION) ){
+        lua_pushcfunction(lua,olua_disconnect);
+        lua_setfield(lua,-2,"__gc");
+        lua_pushstring(lua,TNAME_CONNECTION);
+        lua_setfield(lua,-2,"__metatable");
+    }
+    lua_setmetatable(lua,-2);
+    lua_setfield(lua,-2,"handle");
+
+    /* session attributes and the option `trace` */
+    status = OCIAttrGet( svchp , OCI_HTYPE_SVCCTX , (dvoid*)&conn->sesshp ,
+                NULL , OCI_ATTR_SESSION , errhp );
+    if( status != OCI_SUCCESS )
+        checkerr(lua,errhp,status);
+    olua_setinfo(lua,conn,-1);
+    olua_opentrace(lua,conn,-1);
+
+    /* method: exec */
+    lua_pushcfunction(lua,olua_exec);
+    lua_setfield(lua,-2,"exec");
+
+    /* method: prepare */
+    lua_pushcfunction(lua,olua_prepare);
+    lua_setfield(lua,-2,"prepare");
+
+    /* method: page */
+    lua_pushcfunction(lua,olua_page);
+    lua_setfield(lua,-2,"page");
+
+    /* method: cursor */
+    lua_pushcfunction(lua,olua_cursor);
+    lua_setfield(lua,-2,"cursor");
+
+    /* method: execmany */
+    lua_pushcfunction(lua,olua_execmany);
+    lua_setfield(lua,-2,"execmany");
+
+    /* method: export */
+    lua_pushcfunction(lua,olua_export);
+    lua_setfield(lua,-2,"export");
+
+    /* method: load */
+    lua_pushcfunction(lua,olua_load);
+    lua_setfield(lua,-2,"load");
+
+    /* method: directpath */
+    lua_pushcfunction(lua,olua_directpath);
+    lua_setfield(lua,-2,"directpath");
+
+    /* method: lob */
+    lua_pushcfunction(lua,olua_newlob);
+    lua_setfield(lua,-2,"lob");
+
+    /* method: cachestats */
+    lua_pushcfunction(lua,olua_cachestats);
+    lua_setfield(lua,-2,"cachestats");
+
+    /* method: stats */
+    lua_pushcfunction(lua,olua_connection_stats);
+    lua_setfield(lua,-2,"stats");
+
+    /* method: setinfo */
+    lua_pushcfunction(lua,olua_connection_setinfo);
+    lua_setfield(lua,-2,"setinfo");
+
+    /* method: commit */
+    lua_pushcfunction(lua,olua_commit);
+    lua_setfield(lua,-2,"commit");
+
+    /* method: rollback */
+    lua_pushcfunction(lua,olua_rollback);
+    lua_setfield(lua,-2,"rollback");
+
+    /* method: disconnect */
+    lua_pushcfunction(lua,olua_disconnect);
+    lua_setfield(lua,-2,"disconnect");
+
+    /* method: logoff */
+    lua_pushcfunction(lua,olua_disconnect);
+    lua_setfield(lua,-2,"logoff");
+
+    /* method: close */
+    lua_pushcfunction(lua,olua_disconnect);
+    lua_setfield(lua,-2,"close");
+
+    /* method: release */
+    lua_pushcfunction(lua,olua_disconnect);
+    lua_setfield(lua,-2,"release");
+
+    DEBUG( puts("successfully return 1") );
+    return 1;
+}
+
+
+/** olua_statement_push
+ *   push a new statement-object of the connection at `connection` for
+ *   the statement-handle `stmthp`, which is borrowed from the parent
+ *   statement (implicit results), or a new one allocated when NULL.
+ * stack-out
+ *   (-1) statement-object
+ */
+static struct olua_statement *olua_statement_push(lua_State *lua,int connection,OCIStmt *stmthp)
+{
+    struct olua_statement *statement=NULL;
+    sword status;
+    OCIEnv *envhp = olua_envhp(lua);
+    struct olua_connect *conn=olua_tohandle(lua,connection,TNAME_CONNECTION);
+
+    connection = lua_absindex(lua,connection);
+
+    /*** new statement object ***/
+    lua_newtable(lua);
+    statement = olua_statement_new( lua_newuserdata(lua,sizeof(struct olua_statement)));
+    assert( statement != NULL );
+
+    statement->envhp = envhp;
+    statement->conn = conn;
+    statement->allocf = lua_getallocf(lua,&statement->allocud);
+    OCIHandleAlloc(envhp , (dvoid**)&statement->errhp , OCI_HTYPE_ERROR , 0 , NULL );
+
+    if( luaL_newmetatable(lua,TNAME_STATEMENT) ){
+        /* destructor */
+        lua_pushcfunction(lua,olua_statement_gc); /* destructor's func */
+        lua_setfield(lua,-2,"__gc"); /* assign destructor to meta table */
+
+        lua_pushstring(lua,TNAME_STATEMENT);
+        lua_setfield(lua,-2,"__metatable");
+    }
+    lua_setmetatable(lua,-2); /* assign metatable to user-object */
+    lua_setfield(lua,-2,"handle");  /* assign user-object to instance */
+
+    if( stmthp != NULL ){
+        statement->stmthp = stmthp;
+        statement->borrowed = 1;
+    }else{
+        DEBUG( puts("CALL: OCIHandleAlloc") );
+        status = OCIHandleAlloc(
+            envhp ,
+            (dvoid**)&statement->stmthp ,
+            OCI_HTYPE_STMT  ,
+            0 ,
+            NULL );
+        DEBUG( puts("EXIT: OCIHandleAlloc") );
+
+        if( status != OCI_SUCCESS ){
+            checkerr(lua,statement->errhp,status);
+            abort();
+        }
+    }
+
+    /* method: bind */
+    lua_pushcfunction(lua,olua_bind);
+    lua_setfield(lua,-2,"bind");
+
+    /* method: execute */
+    lua_pushcfunction(lua,olua_statement_execute);
+    lua_setfield(lua,-2,"execute");
+
+    /* method: fetch */
+    lua_pushcfunction(lua,olua_fetch);
+    lua_setfield(lua,-2,"fetch");
+
+    /* method: fetchcolumns */
+    lua_pushcfunction(lua,olua_fetchcolumns);
+    lua_setfield(lua,-2,"fetchcolumns");
+
+    /* method: fetch_absolute */
+    lua_pushcfunction(lua,olua_fetch_absolute);
+    lua_setfield(lua,-2,"fetch_absolute");
+
+    /* method: fetch_relative */
+    lua_pushcfunction(lua,olua_fetch_relative);
+    lua_setfield(lua,-2,"fetch_relative");
+
+    /* method: stats */
+    lua_pushcfunction(lua,olua_statement_stats);
+    lua_setfield(lua,-2,"stats");
+
+    /* member: connection */
+    lua_pushvalue(lua,connection);
+    lua_setfield(lua,-2,"connection");
+
+    return statement;
+}
+
+/** olua_prepare
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) sql string
+ * stack-out (success)
+ *   (+1) statement-handle
+ */
+static int olua_prepare( lua_State *lua )
+{
+    struct olua_statement *statement=NULL;
+    unsigned long long start;
+    sword status;
+
+    const char *sql = luaL_checkstring(lua,2);
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+
+    DEBUG( puts("ENTER: olua_prepare()"));
+
+    statement = olua_statement_push(lua,1,NULL);
+
+    DEBUG( printf("SQL=[%s]\n",sql) );
+    start = olua_now();
+    status = OCIStmtPrepare(
+        statement->stmthp , statement->errhp, (CONST text*)sql , (ub4)strlen(sql) ,
+        (ub4)OCI_NTV_SYNTAX , (ub4)OCI_DEFAULT );
+    OLUA_COUNT(statement,prepare_ns,olua_now()-start);
+    OLUA_COUNT(statement,prepares,1);
+
+    DEBUG( printf("OCIStmtPrepare()=%d\n",status));
+
+    if( status != OCI_SUCCESS ){
+        checkerr(lua,statement->errhp,status);
+        abort();
+    }
+    if( conn->trace != NULL ){
+        olua_sqlid(sql,statement->sql_id);
+        olua_trace(statement,"prepare",start,0,sql);
+    }
+    DEBUG( printf("Statement-handle=%p\n",statement->stmthp) );
+    DEBUG( puts("LEAVE: olua_prepare(success)"));
+
+    /* member: sql-string */
+    lua_pushvalue(lua,2);
+    lua_setfield(lua,-2,"sql");
+
+    return 1;
+}
+
+/** olua_cursor
+ *   CONN:cursor(): a statement-object to bind as a REF CURSOR (SQLT_RSET)
+ *   out-parameter. After the PL/SQL is executed, STMT:execute() on it
+ *   does not execute anything but starts to fetch the cursor opened.
+ * stack-in:
+ *   (+1) connection.
+ * stack-out
+ *   (+1) statement-object
+ */
+static int olua_cursor( lua_State *lua )
+{
+    struct olua_statement *statement;
+
+    statement = olua_statement_push(lua,1,NULL);
+    statement->refcursor = 1;
+    return 1;
+}
+
+/* olua_isinteger
+ *   return true and store the value if the number at `index` is an
+ *   integer which fits in 64bit.
+ */
+static int olua_isinteger(lua_State *lua,int index,sb8 *value)
+{
+#if LUA_VERSION_NUM >= 503
+    if( lua_isinteger(lua,index) ){
+        *value = (sb8)lua_tointeger(lua,index);
+        return 1;
+    }
+    return 0;
+#else
+    lua_Number n=lua_tonumber(lua,index);
+
+    if( n >= -9223372036854775808.0 && n < 9223372036854775808.0 &&
+        (lua_Number)(sb8)n == n )
+    {
+        *value = (sb8)n;
+        return 1;
+    }
+    return 0;
+#endif
+}
+
+/* olua_bindnumber
+ *   store the number at `index` into the bind buffer as a 64bit integer
+ *   or a double.
+ * return
+ *   data type for OCIBindByXXX. *size is set to value_sz.
+ */
+static ub2 olua_bindnumber(lua_State *lua,int index,struct olua_bind_buffer *b,sb4 *size)
+{
+    if( olua_isinteger(lua,index,&b->u.integer) ){
+        *size = (sb4)sizeof(sb8);
+        return SQLT_INT;
+    }
+    b->u.number = lua_tonumber(lua,index);
+    *size = (sb4)sizeof(double);
+    return SQLT_FLT;
+}
+
+/* olua_keepbind
+ *   keep the lob-object or the cursor at `index` in the member `member`
+ *   of the statement at `stmt`, so that its handle lives as long as the
+ *   bind.
+ */
+static void olua_keepbind(lua_State *lua,int stmt,int index,const char *member)
+{
+    stmt = lua_absindex(lua,stmt);
+    index = lua_absindex(lua,index);
+    lua_getfield(lua,stmt,member);
+    if( ! lua_istable(lua,-1) ){
+        lua_pop(lua,1);
+        lua_newtable(lua);
+        lua_pushvalue(lua,-1);
+        lua_setfield(lua,stmt,member);
+    }
+    lua_pushvalue(lua,index);
+    lua_pushboolean(lua,1);
+    lua_rawset(lua,-3);
+    lua_pop(lua,1);
+}
+
+/* olua_tocursor
+ *   the statement of the statement-object at `index` made by CONN:cursor,
+ *   or NULL for the other values (a table of named binds).
+ */
+static struct olua_statement *olua_tocursor(lua_State *lua,int index)
+{
+    struct olua_statement *statement=NULL;
+
+    if( lua_istable(lua,index) ){
+        lua_getfield(lua,index,"handle");
+        statement = luaL_testudata(lua,-1,TNAME_STATEMENT);
+        lua_pop(lua,1);
+    }
+    return statement != NULL && statement->refcursor ? statement : NULL;
+}
+
+/* An out-bind made by oluacle.out or oluacle.inout. It is bound with
+ * OCIBindDynamic, so that it receives the OUT parameter of PL/SQL once
+ * per execution, or all the rows of RETURNING ... INTO (a row per
+ * iteration of array DML, or the rows updated by one UPDATE).
+ * OCI writes the values into blocks allocated by the callback, which
+ * are moved into the out-object as OUT[1..N] after the execution.
+ */
+struct olua_outblock {
+    struct olua_outblock *next;
+    ub4 rows;       /* values returned into the block */
+    ub4 *len;
+    sb2 *ind;
+    ub2 *rcode;
+    char *data;
+};
+
+struct olua_outbind {
+    ub2 type;       /* SQLT_INT , SQLT_FLT or SQLT_CHR */
+    sb4 size;       /* bytes of a value */
+    int returning;  /* bound to DML: rows are asked per iteration */
+    OCIError *errhp;   /* of the statement bound last */
+    struct olua_outblock *head , *last;
+    ub4 count;      /* values stored into the out-object */
+    sb2 in_ind;     /* the IN value of oluacle.inout, or NULL */
+    ub4 in_len;
+    union{
+        sb8    integer;
+        double number;
+        char   buffer[1];
+    }in;
+};
+
+/* olua_outbind_free
+ *   drop the blocks which are not stored into the out-object.
+ */
+static void olua_outbind_free(struct olua_outbind *out)
+{
+    while( out->head != NULL ){
+        struct olua_outblock *next=out->head->next;
+
+        free(out->head);
+        out->head = next;
+    }
+    out->last = NULL;
+}
+
+static int olua_outbind_gc(lua_State *lua)
+{
+    olua_outbind_free(luaL_checkudata(lua,1,TNAME_OUTBIND));
+    return 0;
+}
+
+/* olua_toout
+ *   the out-bind of the out-object at `index`, or NULL for the other
+ *   values.
+ */
+static struct olua_outbind *olua_toout(lua_State *lua,int index)
+{
+    struct olua_outbind *out=NULL;
+
+    if( lua_istable(lua,index) ){
+        lua_getfield(lua,index,"handle");
+        out = luaL_testudata(lua,-1,TNAME_OUTBIND);
+        lua_pop(lua,1);
+    }
+    return out;
+}
+
+/* olua_outbind_push
+ *   push a new out-object { handle=out-bind } for values of `type`.
+ */
+static struct olua_outbind *olua_outbind_push(lua_State *lua,ub2 type,sb4 size)
+{
+    struct olua_outbind *out;
+
+    lua_newtable(lua);
+    out = lua_newuserdata(lua,sizeof(struct olua_outbind) + size);
+    memset(out,0,sizeof(struct olua_outbind));
+    out->type = type;
+    out->size = size;
+    out->in_ind = OCI_IND_NULL;
+    if( luaL_newmetatable(lua,TNAME_OUTBIND) ){
+        lua_pushcfunction(lua,olua_outbind_gc);
+        lua_setfield(lua,-2,"__gc");
+        lua_pushstring(lua,TNAME_OUTBIND);
+        lua_setfield(lua,-2,"__metatable");
+    }
+    lua_setmetatable(lua,-2);
+    lua_setfield(lua,-2,"handle");
+    return out;
+}
+
+/* lua-function: olua_out
+ *  stack-in
+ *    (+1) "number" , "integer" or "string"
+ *    (+2) bytes of the string (optional: 4000)
+ *  return
+ *    (+1) out-object to bind as an OUT parameter or to RETURNING INTO
+ */
+int olua_out(lua_State *lua)
+{
+    static const char *const types[]={ "number" , "integer" , "string" , NULL };
+    int type=luaL_checkoption(lua,1,NULL,types);
+    lua_Integer size=luaL_optinteger(lua,2,4000);
+
+    luaL_argcheck(lua,size > 0 && size <= 32767,2,"size out of range");
+    if( type == 0 )
+        olua_outbind_push(lua,SQLT_FLT,sizeof(double));
+    else if( type == 1 )
+        olua_outbind_push(lua,SQLT_INT,sizeof(sb8));
+    else
+        olua_outbind_push(lua,SQLT_CHR,(sb4)size);
+    return 1;
+}
+
+/* lua-function: olua_inout
+ *  stack-in
+ *    (+1) the IN value: number or string
+ *    (+2) bytes of the string returned (optional: 4000)
+ *  return
+ *    (+1) out-object to bind as an IN OUT parameter
+ */
+int olua_inout(lua_State *lua)
+{
+    struct olua_outbind *out;
+
+    if( lua_type(lua,1) == LUA_TNUMBER ){
+        sb8 value;
+
+        if( olua_isinteger(lua,1,&value) ){
+            out = olua_outbind_push(lua,SQLT_INT,sizeof(sb8));
+            out->in.integer = value;
+        }else{
+            out = olua_outbind_push(lua,SQLT_FLT,sizeof(double));
+            out->in.number = lua_tonumber(lua,1);
+        }
+        out->in_len = (ub4)out->size;
+    }else{
+        size_t len;
+        const char *s=luaL_checklstring(lua,1,&len);
+        lua_Integer size=luaL_optinteger(lua,2,4000);
+
+        if( size < (lua_Integer)len )
+            size = (lua_Integer)len;
+        luaL_argcheck(lua,size > 0 && size <= 32767,2,"size out of range");
+        out = olua_outbind_push(lua,SQLT_CHR,(sb4)size);
+        memcpy(out->in.buffer,s,len);
+        out->in_len = (ub4)len;
+    }
+    out->in_ind = 0;
+    return 1;
+}
+
+/* olua_outbind_in
+ *   OCICallbackInBind: give the IN value (NULL for oluacle.out).
+ */
+static sb4 olua_outbind_in(dvoid *ictxp,OCIBind *bindp,ub4 iter,ub4 index,
+    dvoid **bufpp,ub4 *alenp,ub1 *piecep,dvoid **indpp)
+{
+    struct olua_outbind *out=ictxp;
+
+    *bufpp = out->in_ind == 0 ? (dvoid*)&out->in : NULL;
+    *alenp = out->in_ind == 0 ? out->in_len : 0;
+    *piecep = OCI_ONE_PIECE;
+    *indpp = &out->in_ind;
+    return OCI_CONTINUE;
+}
+
+/* olua_outbind_out
+ *   OCICallbackOutBind: give the cell for the row `index` of the
+ *   iteration. A block for the rows of the iteration is allocated at
+ *   the first row.
+ */
+static sb4 olua_outbind_out(dvoid *octxp,OCIBind *bindp,ub4 iter,ub4 index,
+    dvoid **bufpp,ub4 **alenpp,ub1 *piecep,dvoid **indpp,ub2 **rcodepp)
+{
+    struct olua_outbind *out=octxp;
+    struct olua_outblock *block;
+
+    if( index == 0 ){
+        ub4 rows=1;
+        size_t data_size;
+
+        if( out->returning &&
+            OCIAttrGet(bindp,OCI_HTYPE_BIND,(dvoid*)&rows,NULL,
+                OCI_ATTR_ROWS_RETURNED,out->errhp) != OCI_SUCCESS )
+            return OCI_ERROR;
+        /* a cell is given even when no rows are returned */
+        data_size = OLUA_ALIGN( (size_t)out->size * ( rows > 0 ? rows : 1 ) );
+        block = malloc(OLUA_ALIGN(sizeof(struct olua_outblock)) + data_size
+                    + ( rows > 0 ? rows : 1 ) * (sizeof(ub4)+sizeof(sb2)+sizeof(ub2)));
+        if( block == NULL )
+            return OCI_ERROR;
+        block->next = NULL;
+        block->rows = rows;
+        block->data = (char*)block + OLUA_ALIGN(sizeof(struct olua_outblock));
+        block->len = (ub4*)( block->data + data_size );
+        block->ind = (sb2*)( block->len + ( rows > 0 ? rows : 1 ) );
+        block->rcode = (ub2*)( block->ind + ( rows > 0 ? rows : 1 ) );
+        if( out->last != NULL )
+            out->last->next = block;
+        else
+            out->head = block;
+        out->last = block;
+    }
+    block = out->last;
+    if( block == NULL || ( index > 0 && index >= block->rows ) )
+        return OCI_ERROR;
+    block->len[index] = (ub4)out->size;
+    block->ind[index] = 0;
+    block->rcode[index] = 0;
+    *bufpp = block->data + (size_t)out->size * index;
+    *alenpp = &block->len[index];
+    *piecep = OCI_ONE_PIECE;
+    *indpp = &block->ind[index];
+    *rcodepp = &block->rcode[index];
+    return OCI_CONTINUE;
+}
+
+/* olua_outbind_set
+ *   bind the out-bind to the placeholder `name` (":NAME"), or to the
+ *   position `pos` when name is NULL. The values left by an execution
+ *   which failed are dropped.
+ */
+static void olua_outbind_set(
+    lua_State *lua ,
+    struct olua_statement *statement ,
+    struct olua_outbind *out ,
+    OCIBind **bindp ,
+    ub4 pos ,
+    const char *name )
+{
+    sword status;
+    ub2 type=0;
+
+    status = OCIAttrGet(statement->stmthp,OCI_HTYPE_STMT,(dvoid*)&type,NULL,
+                OCI_ATTR_STMT_TYPE,statement->errhp);
+    if( status != OCI_SUCCESS ){
+        checkerr(lua,statement->errhp,status);
+        return;
+    }
+    out->returning = ( type == OCI_STMT_INSERT || type == OCI_STMT_UPDATE ||
+                       type == OCI_STMT_DELETE || type == OCI_STMT_MERGE );
+    out->errhp = statement->errhp;
+    olua_outbind_free(out);
+
+    if( name != NULL ){
+        status = OCIBindByName( statement->stmthp , bindp , statement->errhp ,
+                    (CONST text*)name , (sb4)strlen(name) ,
+                    NULL , out->size , out->type ,
+                    NULL , NULL , NULL , 0 , NULL , OCI_DATA_AT_EXEC );
+    }else{
+        status = OCIBindByPos( statement->stmthp , bindp , statement->errhp ,
+                    pos ,
+                    NULL , out->size , out->type ,
+                    NULL , NULL , NULL , 0 , NULL , OCI_DATA_AT_EXEC );
+    }
+    if( status == OCI_SUCCESS )
+        status = OCIBindDynamic( *bindp , statement->errhp ,
+                    (dvoid*)out , olua_outbind_in ,
+                    (dvoid*)out , olua_outbind_out );
+    if( status != OCI_SUCCESS )
+        checkerr(lua,statement->errhp,status);
+}
+
+/* olua_outbind_collect
+ *   move the values returned into each out-object of the table at `outs`
+ *   as OUT[1..N]. They are appended to the values of the previous batch
+ *   unless `reset`. NULL is stored as the option `null` or false.
+ */
+static void olua_outbind_collect(lua_State *lua,struct olua_connect *conn,int outs,int reset)
+{
+    outs = lua_absindex(lua,outs);
+    lua_pushnil(lua);
+    while( lua_next(lua,outs) ){
+        int object=lua_gettop(lua);
+        struct olua_outbind *out=olua_toout(lua,object);
+        struct olua_outblock *block;
+        ub4 i;
+
+        if( out != NULL && reset ){
+            for( ; out->count > 0 ; out->count-- ){
+                lua_pushnil(lua);
+                lua_rawseti(lua,object,(int)out->count);
+            }
+        }
+        for( block=(out != NULL ? out->head : NULL) ; block != NULL ; block=block->next ){
+            for( i=0 ; i < block->rows ; i++ ){
+                const char *p=block->data + (size_t)out->size * i;
+
+                if( block->ind[i] != 0 ){
+                    if( conn->null_ref != LUA_NOREF )
+                        lua_rawgeti(lua,LUA_REGISTRYINDEX,conn->null_ref);
+                    else
+                        lua_pushboolean(lua,0);
+                }else if( out->type == SQLT_INT ){
+                    olua_pushint64(lua,*(const sb8*)p);
+                }else if( out->type == SQLT_FLT ){
+                    lua_pushnumber(lua,*(const double*)p);
+                }else{
+                    lua_pushlstring(lua,p,block->len[i]);
+                }
+                lua_rawseti(lua,object,(int)++out->count);
+            }
+        }
+        if( out != NULL )
+            olua_outbind_free(out);
+        lua_pop(lua,1);
+    }
+}
+
+/* olua_outbind_discard
+ *   drop the values left in the out-objects of the table at `outs`.
+ */
+static void olua_outbind_discard(lua_State *lua,int outs)
+{
+    struct olua_outbind *out;
+
+    outs = lua_absindex(lua,outs);
+    lua_pushnil(lua);
+    while( lua_next(lua,outs) ){
+        if( (out=olua_toout(lua,-1)) != NULL )
+            olua_outbind_free(out);
+        lua_pop(lua,1);
+    }
+}
+
+/* olua_keepout
+ *   keep the out-object at `index` (or none when index is 0) in the member
+ *   `outs` of the statement at `stmt` under the key of the slot `b`.
+ */
+static void olua_keepout(lua_State *lua,int stmt,int index,struct olua_bind_buffer *b)
+{
+    stmt = lua_absindex(lua,stmt);
+    if( index != 0 )
+        index = lua_absindex(lua,index);
+    lua_getfield(lua,stmt,"outs");
+    if( ! lua_istable(lua,-1) ){
+        lua_pop(lua,1);
+        lua_newtable(lua);
+        lua_pushvalue(lua,-1);
+        lua_setfield(lua,stmt,"outs");
+    }
+    if( b->name.s != NULL )
+        lua_pushstring(lua,b->name.s);
+    else
+        lua_pushinteger(lua,(lua_Integer)b->pos);
+    if( index != 0 )
+        lua_pushvalue(lua,index);
+    else
+        lua_pushnil(lua);
+    lua_rawset(lua,-3);
+    lua_pop(lua,1);
+}
+
+/* olua_bind_slot
+ *   find the slot of the placeholder `name` (without ':'), or of the
+ *   position `pos` when name is NULL, which holds `size` bytes at least.
+ *   A slot is made or grown (twice at least) here, and then it has to
+ *   be bound again.
+ */
+static struct olua_bind_buffer *olua_bind_slot(
+    lua_State *lua ,
+    struct olua_statement *statement ,
+    ub4 pos ,
+    const char *name ,
+    size_t name_len ,
+    size_t size )
+{
+    struct olua_bind_buffer *b=NULL , *p;
+    size_t extra=0 , alloc;
+    int i;
+
+    for( i=0 ; i < statement->nbinds ; i++ ){
+        b = statement->bind_buffer[i];
+        if( name != NULL
+            ? ( b->name.s != NULL && strlen(b->name.s) == name_len+1
+                && memcmp(b->name.s+1,name,name_len) == 0 )
+            : ( b->name.s == NULL && b->pos == pos ) )
+            break;
+    }
+    if( i >= statement->nbinds ){
+        b = NULL;
+        if( statement->nbinds >= statement->bind_alloc ){
+            int n=( statement->bind_alloc > 0 ? statement->bind_alloc*2 : 8 );
+            struct olua_bind_buffer **array=olua_alloc(statement,sizeof(struct olua_bind_buffer*)*n);
+
+            if( array == NULL ){
+                luaL_error(lua,"bind: not enough memory");
+                return NULL;
+            }
+            if( statement->bind_buffer != NULL ){
+                memcpy(array,statement->bind_buffer,sizeof(struct olua_bind_buffer*)*statement->nbinds);
+                olua_free(statement,statement->bind_buffer,
+                    sizeof(struct olua_bind_buffer*) * statement->bind_alloc);
+            }
+            statement->bind_buffer = array;
+            statement->bind_alloc = n;
+        }
+    }else if( b->size >= size ){
+        return b;
+    }
+
+    if( b != NULL ){
+        extra = b->size;
+        if( b->name.s != NULL )
+            name_len = strlen(b->name.s) - 1;
+    }
+    while( sizeof(b->u) + extra < size )
+        extra = ( extra > 0 ? extra*2 : size );
+
+    /* the name ":NAME" follows the member u in the same block */
+    alloc = sizeof(struct olua_bind_buffer) + extra + ( name_len + 2 );
+    if( (p = olua_alloc(statement,alloc)) == NULL ){
+        luaL_error(lua,"bind: not enough memory");
+        return NULL;
+    }
+    p->alloc = alloc;
+    if( b != NULL ){
+        p->bind = b->bind;      /* the bind-handle is taken over */
+        p->pos = b->pos;
+        p->name.s = NULL;
+        if( b->name.s != NULL ){
+            p->name.s = (char*)p + sizeof(struct olua_bind_buffer) + extra;
+            memcpy(p->name.s,b->name.s,name_len+2);
+        }
+        olua_free(statement,b,b->alloc);
+    }else{
+        p->bind = NULL;
+        p->name.s = NULL;
+        p->pos = pos;
+        if( name != NULL ){
+            p->name.s = (char*)p + sizeof(struct olua_bind_buffer) + extra;
+            p->name.s[0] = ':';
+            memcpy(p->name.s+1,name,name_len);
+            p->name.s[name_len+1] = '\0';
+        }
+        statement->nbinds++;
+    }
+    p->dty = 0;
+    p->size = sizeof(p->u) + extra;
+    p->indicator = 0;
+    p->u.buffer[0] = '\0';
+    statement->bind_buffer[i] = p;
+    return p;
+}
+
+/* olua_bind_value
+ *   set the value at `index` to the slot of the placeholder `name` (without
+ *   ':') or of the position `pos`. The statement-object is at `stmt`.
+ */
+static void olua_bind_value(
+    lua_State *lua ,
+    struct olua_statement *statement ,
+    int stmt ,
+    int index ,
+    ub4 pos ,
+    const char *name ,
+    size_t name_len )
+{
+    struct olua_bind_buffer *b;
+    struct olua_lob *lob;
+    struct olua_statement *cursor;
+    struct olua_outbind *out;
+    sword status;
+    sb4 size;
+    ub2 dty;
+
+    index = lua_absindex(lua,index);
+    OLUA_COUNT(statement,binds,1);
+    if( lua_toboolean(lua,index) == 0 ){ /* nil or false => NULL */
+        b = olua_bind_slot(lua,statement,pos,name,name_len,1);
+        b->indicator = OCI_IND_NULL;
+        DEBUG( printf("BIND: %s/%d=>NULL\n",name?name:"",(int)pos) );
+        if( b->dty != 0 && b->dty != OLUA_DTY_OUT )
+            return;     /* NULL for any type */
+        dty = SQLT_STR;
+        size = (sb4)b->size;
+    }else if( (lob=luaL_testudata(lua,index,TNAME_LOB)) != NULL ){
+        b = olua_bind_slot(lua,statement,pos,name,name_len,sizeof(OCILobLocator*));
+        b->indicator = 0;
+        b->u.locator = lob->locator;
+        olua_keepbind(lua,stmt,index,"lobs");
+        DEBUG( printf("BIND: %s/%d=>%p(lob)\n",name?name:"",(int)pos,lob->locator) );
+        dty = lob->type;
+        size = sizeof(OCILobLocator*);
+    }else if( (cursor=olua_tocursor(lua,index)) != NULL ){
+        luaL_argcheck(lua,! cursor->borrowed,index,"an implicit result can not be bound");
+        b = olua_bind_slot(lua,statement,pos,name,name_len,sizeof(OCIStmt*));
+        b->indicator = 0;
+        b->u.cursor = cursor->stmthp;
+        olua_keepbind(lua,stmt,index,"cursors");
+        DEBUG( printf("BIND: %s/%d=>%p(cursor)\n",name?name:"",(int)pos,cursor->stmthp) );
+        dty = SQLT_RSET;
+        size = 0;
+    }else if( (out=olua_toout(lua,index)) != NULL ){
+        /* bound again always: the callbacks take the out-object */
+        b = olua_bind_slot(lua,statement,pos,name,name_len,1);
+        DEBUG( printf("BIND: %s/%d=>%p(out)\n",name?name:"",(int)pos,(void*)out) );
+        b->dty = 0;
+        olua_outbind_set(lua,statement,out,&b->bind,b->pos,b->name.s);
+        olua_keepout(lua,stmt,index,b);
+        b->dty = OLUA_DTY_OUT;
+        return;
+    }else if( lua_isnumber(lua,index) ){
+        b = olua_bind_slot(lua,statement,pos,name,name_len,sizeof(sb8));
+        b->indicator = 0;
+        dty = olua_bindnumber(lua,index,b,&size);
+        DEBUG( printf("BIND: %s/%d=>%g(number)\n",name?name:"",(int)pos,lua_tonumber(lua,index)) );
+    }else{
+        size_t len;
+        const char *string=lua_tolstring(lua,index,&len);
+
+        assert( string != NULL );
+        b = olua_bind_slot(lua,statement,pos,name,name_len,len+1);
+        b->indicator = 0;
+        memcpy(b->u.buffer,string,len+1);
+        DEBUG( printf("BIND: %s/%d=>'%s'(string)\n",name?name:"",(int)pos,string) );
+        dty = SQLT_STR;
+        size = (sb4)b->size;
+    }
+    if( b->dty == OLUA_DTY_OUT )
+        olua_keepout(lua,stmt,0,b);
+    if( b->dty == dty )
+        return;
+
+    if( b->name.s != NULL ){
+        status = OCIBindByName(
+                    statement->stmthp ,
+                    &b->bind ,
+                    statement->errhp ,
+                    b->name.u ,
+                    (sb4)strlen(b->name.s) ,
+                    (dvoid *)&b->u , /* valuep */
+                    size , /* value_sz */
+                    dty , /* dty */
+                    &b->indicator ,
+                    NULL ,
+                    NULL ,
+                    0 ,
+                    NULL ,
+                    OCI_DEFAULT );
+    }else{
+        status = OCIBindByPos(
+                    statement->stmthp ,
+                    &b->bind ,
+                    statement->errhp ,
+                    b->pos , /* position */
+                    (dvoid *)&b->u , /* valuep */
+                    size ,  /* value_sz */
+                    dty , /* dty */
+                    &b->indicator ,
+                    (ub2*)NULL ,
+                    (ub2*)NULL ,
+                    (ub4)0 ,  /* maxarr_len */
+                    (ub4*)NULL , /* curelep */
+                    OCI_DEFAULT /* mode */
+                );
+    }
+    if( status != OCI_SUCCESS ){
+        b->dty = 0;
+        checkerr(lua,statement->errhp,status);
+        return;
+    }
+    b->dty = dty;
+}
+
+/*
  * -nbinds-1   : statement-handle
  * -nbinds..-1 : bind-variables
  */
-static int olua_bind_core( lua_State *lua , int nbinds )
+static int olua_bind_core( lua_State *lua , int nbinds )
+{
+    int i;
+    int stmt=lua_absindex(lua,-nbinds-1);
+    struct olua_statement *statement=olua_tohandle(lua,stmt,TNAME_STATEMENT);
+
+    for(i=0;i<nbinds;i++){
+        int sp=stmt+1+i;
+
+        DEBUG( printf("try bind %d\n",i+1));
+        DEBUG( printf("Statement-handle=%p\n",statement->stmthp) );
+
+        if( lua_istable(lua,sp) && olua_tocursor(lua,sp) == NULL && olua_toout(lua,sp) == NULL ){
+            lua_pushnil(lua);
+            while( lua_next(lua,sp) ){
+                const char *key; size_t key_len;
+
+                lua_pushvalue(lua,-2);
+                key = lua_tolstring(lua,-1,&key_len);
+                if( key[0] == ':' ){
+                    key++;
+                    key_len--;
+                }
+                olua_bind_value(lua,statement,stmt,-2,0,key,key_len);
+                lua_pop(lua,2); /* drop value and key duplicated */
+            }
+        }else{
+            olua_bind_value(lua,statement,stmt,sp,i+1,NULL,0);
+        }
+    }
+    lua_pushboolean(lua,1);
+    DEBUG( printf("LEAVE: olua_bind(successfully)\n") );
+    return 1;
+}
+
+/* olua_countbinds
+ *   count values given by `n` bind-arguments from `first`.
+ *   a table gives one value per key.
+ */
+static int olua_countbinds(lua_State *lua,int first,int n)
+{
+    int i,count=0;
+
+    for(i=first ; i < first+n ; i++ ){
+        if( lua_istable(lua,i) && olua_tocursor(lua,i) == NULL && olua_toout(lua,i) == NULL ){
+            lua_pushnil(lua);
+            while( lua_next(lua,i) ){
+                lua_pop(lua,1);
+                count++;
+            }
+        }else{
+            count++;
+        }
+    }
+    return count;
+}
+
+/** olua_bind
+ *
+ * stack-in:
+ *  +1   = statement-object(table)
+ *  +2.. = bind-variables
+ * stack-out:
+ *  +3   = true:succcess , nil:failure
+ */
+static int olua_bind( lua_State *lua )
+{
+    int i=lua_gettop(lua);
+    return olua_bind_core(lua,i-1);
+}
+
+static olua_decoder olua_decoder_for(struct olua_fetch_buffer *fetch_buffer);
+
+/* olua_fetch_buffer_alloc
+ *   describe the columns and make the define arrays in one arena of the
+ *   statement: the array of nodes, and the data, indicator, length arrays
+ *   and the name of each column.
+ */
+static struct olua_fetch_buffer *olua_fetch_buffer_alloc(
+    lua_State *lua ,
+    struct olua_statement *statement )
+{
+    struct olua_fetch_buffer *nodes , *curr;
+    const char **names;
+    ub4 *names_len;
+    dvoid *mypard;
+    ub4 ncols=0 , counter;
+    size_t data_size , total;
+    char *p;
+    sword status;
+
+    DEBUG( puts("ENTER olua_fetch_buffer_alloc()") );
+
+    status = OCIAttrGet( statement->stmthp , OCI_HTYPE_STMT , (dvoid*)&ncols ,
+                (ub4*)0 , OCI_ATTR_PARAM_COUNT , statement->errhp );
+    if( status != OCI_SUCCESS ){
+        checkerr(lua,statement->errhp,status);
+        return NULL;
+    }
+
+    /* 1st pass: describe into the nodes on the Lua stack */
+    nodes = lua_newuserdata(lua,( sizeof(struct olua_fetch_buffer) +
+                sizeof(const char*) + sizeof(ub4) ) * ( ncols ? ncols : 1 ));
+    names = (const char**)( nodes + ncols );
+    names_len = (ub4*)( names + ncols );
+    total = OLUA_ALIGN( sizeof(struct olua_fetch_buffer) * ncols );
+
+    for( counter=0 ; counter < ncols ; counter++ ){
+        curr = olua_fetch_buffer_new( &nodes[counter] );
+        status = OCIParamGet( statement->stmthp , OCI_HTYPE_STMT ,
+                    statement->errhp , &mypard , counter+1 );
+        if( status != OCI_SUCCESS ){
+            checkerr(lua,statement->errhp,status);
+            return NULL;
+        }
+
+        /* f[^TCY擾 */
+        status = OCIAttrGet(
+            mypard ,
+            (ub4)OCI_DTYPE_PARAM ,
+            (dvoid*)&curr->size ,
+            (ub4)0 ,
+            (ub4)OCI_ATTR_DATA_SIZE , 
+            statement->errhp
+        );
+        if( status != OCI_SUCCESS ){
+            DEBUG( puts("can not get datasize") );
+            checkerr(lua,statement->errhp,status);
+            return NULL;
+        }
+        DEBUG( printf("DATASIZE=%d\n",curr->size) );
+
+        /* f[^擾 */
+        status = OCIAttrGet(
+            (dvoid*)mypard , (ub4)OCI_DTYPE_PARAM ,
+            (dvoid*)&curr->type , 
+            (ub4)0 ,
+            (ub4)OCI_ATTR_DATA_TYPE , 
+            statement->errhp
+        );
+        if( status != OCI_SUCCESS ){
+            checkerr(lua,statement->errhp,status);
+            return NULL;
+        }
+        DEBUG( printf("DATATYPE=%d\n" , curr->type ) );
+
+        if( curr->type == SQLT_NUM ){
+            sb2 precision=0;
+            sb1 scale=0;
+
+            /* NUMBER(p) with p<=18 is exact in 64bit integer.
+             * NUMBER without precision has precision 0 and scale -127. */
+            OCIAttrGet( (dvoid*)mypard , (ub4)OCI_DTYPE_PARAM ,
+                (dvoid*)&precision , (ub4*)0 , (ub4)OCI_ATTR_PRECISION ,
+                statement->errhp );
+            OCIAttrGet( (dvoid*)mypard , (ub4)OCI_DTYPE_PARAM ,
+                (dvoid*)&scale , (ub4*)0 , (ub4)OCI_ATTR_SCALE ,
+                statement->errhp );
+            DEBUG( printf("PRECISION=%d SCALE=%d\n",precision,scale) );
+            if( scale == 0 && precision > 0 && precision <= 18 ){
+                curr->type = SQLT_INT;
+                curr->size = sizeof(sb8);
+            }else{
+                curr->type = SQLT_FLT;
+                curr->size = sizeof(double);
+            }
+        }else if( curr->type == SQLT_DAT ){
+            curr->size = 7;
+        }else if( curr->type == SQLT_TIMESTAMP ){
+            curr->dtype = OCI_DTYPE_TIMESTAMP;
+            curr->size = sizeof(OCIDateTime*);
+        }else if( curr->type == SQLT_TIMESTAMP_TZ ||
+                  curr->type == SQLT_TIMESTAMP_LTZ ){
+            /* LTZ is converted to the session time zone by the server */
+            curr->type = SQLT_TIMESTAMP_TZ;
+            curr->dtype = OCI_DTYPE_TIMESTAMP_TZ;
+            curr->size = sizeof(OCIDateTime*);
+        }else if( curr->type == SQLT_CLOB || curr->type == SQLT_BLOB ){
+            /* locators only: the value is read by the lob-object */
+            curr->dtype = OCI_DTYPE_LOB;
+            curr->size = sizeof(OCILobLocator*);
+        }
+        /* 񖼎擾 */
+        status = OCIAttrGet(
+            (dvoid*)mypard, (ub4)OCI_DTYPE_PARAM ,
+            (dvoid*)&names[counter] ,
+            &names_len[counter] ,
+            (ub4)OCI_ATTR_NAME ,
+            statement->errhp 
+        );
+        if( status != OCI_SUCCESS ){
+            checkerr(lua,statement->errhp,status);
+            return NULL;
+        }
+        DEBUG( printf("COLUMN=[%.*s](%d)\n" , names_len[counter] , names[counter] , names_len[counter] ));
+
+        data_size = OLUA_ALIGN( (size_t)curr->size * statement->fetch_size );
+        total += OLUA_ALIGN( data_size + statement->fetch_size * (sizeof(sb2)+sizeof(ub2)) )
+               + OLUA_ALIGN( names_len[counter] + 1 );
+    }
+
+    /* 2nd pass: lay out the arena */
+    if( ncols == 0 || (p = olua_alloc(statement,total)) == NULL ){
+        luaL_error(lua,"olua_fetch_buffer_alloc(): memory allocation error");
+        return NULL;
+    }
+    memcpy( p , nodes , sizeof(struct olua_fetch_buffer) * ncols );
+    nodes = (struct olua_fetch_buffer*)p;
+    p += OLUA_ALIGN( sizeof(struct olua_fetch_buffer) * ncols );
+
+    for( counter=0 ; counter < ncols ; counter++ ){
+        curr = &nodes[counter];
+        curr->decode = olua_decoder_for(curr);
+
+        data_size = OLUA_ALIGN( (size_t)curr->size * statement->fetch_size );
+        curr->u.pointor = p;
+        curr->ind = (sb2*)( p + data_size );
+        curr->len = (ub2*)( curr->ind + statement->fetch_size );
+        curr->rows = statement->fetch_size;
+        p += OLUA_ALIGN( data_size + statement->fetch_size * (sizeof(sb2)+sizeof(ub2)) );
+
+        curr->name = p;
+        memcpy( curr->name , names[counter] , names_len[counter] );
+        curr->name[ names_len[counter] ] = '\0';
+        p += OLUA_ALIGN( names_len[counter] + 1 );
+
+        if( curr->dtype != 0 ){
+            ub4 i;
+            dvoid **desc=(dvoid**)curr->u.pointor;
+
+            for( i=0 ; i < curr->rows ; i++ )
+                desc[i] = NULL;
+        }
+    }
+    lua_pop(lua,1);
+
+    DEBUG(puts("ENTER: OCIDefineByPos"));
+    for( counter=0 ; counter < ncols ; counter++ ){
+        OCIDefine *dfp=NULL;
+
+        curr = &nodes[counter];
+        if( curr->dtype != 0 ){
+            ub4 i;
+            dvoid **desc=(dvoid**)curr->u.pointor;
+
+            for( i=0 ; i < curr->rows ; i++ ){
+                status = OCIDescriptorAlloc( statement->envhp , &desc[i] ,
+                            curr->dtype , 0 , NULL );
+                if( status != OCI_SUCCESS ){
+                    olua_fetch_arena_free( statement , nodes , (int)ncols , total );
+                    luaL_error(lua,"olua_fetch_buffer_alloc(): descriptor allocation error");
+                    return NULL;
+                }
+            }
+        }
+        status = OCIDefineByPos(
+            statement->stmthp ,
+            &dfp ,
+            statement->errhp ,
+            counter+1 ,
+            curr->u.pointor ,
+            curr->size ,
+            curr->type ,
+            curr->ind  ,
+            curr->len ,
+            (ub2*)NULL,
+            OCI_DEFAULT
+        );
+        if( status != OCI_SUCCESS ){
+            olua_fetch_arena_free( statement , nodes , (int)ncols , total );
+            checkerr( lua , statement->errhp , status );
+            return NULL;
+        }
+    }
+    olua_fetch_buffer_gc( statement );
+
+    statement->fetch_arena = total;
+    statement->fetch_alloc = statement->fetch_size;
+    statement->ncols = (int)ncols;
+    DEBUG( printf("LEAVE olua_fetch_buffer_alloc(%p)\n",nodes) );
+    return statement->fetch_buffer = nodes;
+}
+
+/* olua_setnames
+ *   set the array of the column names to the member `names` of the
+ *   statement-object on the top. The rows share these strings instead of
+ *   making them from C strings for each cell.
+ */
+static void olua_setnames(lua_State *lua,struct olua_statement *statement)
+{
+    int c;
+
+    lua_createtable(lua,statement->ncols,0);
+    for( c=0 ; c < statement->ncols ; c++ ){
+        lua_pushstring(lua,statement->fetch_buffer[c].name);
+        lua_rawseti(lua,-2,c+1);
+    }
+    lua_setfield(lua,-2,"names");
+}
+
+OLUA_CONTINUATION(olua_execute)
+
+/* an implicit result is closed by OCI when its parent is executed again */
+#define OLUA_CHECK_RESULT(lua,statement) do{ \
+        if( (statement)->parent != NULL && \
+            (statement)->parent->executions != (statement)->executions ) \
+            luaL_error(lua,"the implicit result is no longer valid"); \
+    }while(0)
+
+/* olua_pushresults
+ *   push the implicit results (DBMS_SQL.RETURN_RESULT) of the PL/SQL
+ *   just executed as statement-objects. They are valid until the PL/SQL
+ *   is executed again.
+ *   stack-in:
+ *     (stmt) statement-object
+ * return
+ *   the number of the results pushed
+ */
+static int olua_pushresults(lua_State *lua,int stmt,struct olua_statement *statement)
+{
+    struct olua_statement *result;
+    OCIStmt *stmthp=NULL;
+    ub4 count=0;
+    ub4 rtype=0;
+    int connection;
+    int n=0;
+
+    stmt = lua_absindex(lua,stmt);
+    /* fails also on the clients before 12.1, which have none */
+    if( OCIAttrGet(statement->stmthp,OCI_HTYPE_STMT,(dvoid*)&count,NULL,
+            OCI_ATTR_IMPLICIT_RESULT_COUNT,statement->errhp) != OCI_SUCCESS || count == 0 )
+        return 0;
+    luaL_checkstack(lua,(int)count+2,"too many implicit results");
+    lua_getfield(lua,stmt,"connection");
+    connection = lua_gettop(lua);
+    while( OCIStmtGetNextResult(statement->stmthp,statement->errhp,
+                (dvoid**)&stmthp,&rtype,OCI_DEFAULT) == OCI_SUCCESS )
+    {
+        if( rtype != OCI_RESULT_TYPE_SELECT )
+            continue;
+        result = olua_statement_push(lua,connection,stmthp);
+        result->refcursor = 1;
+        result->parent = statement;
+        result->executions = statement->executions;
+        /* the parent owns the handle */
+        lua_pushvalue(lua,stmt);
+        lua_setfield(lua,-2,"parent");
+        n++;
+    }
+    lua_remove(lua,connection);
+    return n;
+}
+
+/** olua_execute
+ * stack-in:
+ *   (-1) statement-handle
+ * stack-out:
+ *   nothing
+ */
+static int olua_execute(lua_State *lua)
+{
+    struct olua_statement *statement = olua_tohandle(lua,-1,TNAME_STATEMENT);
+    struct olua_connect *conn;
+    unsigned long long start;
+    sword status;
+    ub2 type;
+    ub4 iters;
+    ub4 mode=OCI_DEFAULT;
+    int stmt;
+
+    DEBUG( puts("ENTER: olua_execute()") );
+
+    /* get connection */
+    lua_getfield(lua,-1,"connection");
+    conn = olua_tohandle(lua,-1,TNAME_CONNECTION);
+    lua_pop(lua,1);
+    
+    if( statement->stmthp == NULL)
+        return luaL_error(lua,"olua_execute: stmt handle is nil.");
+
+    if( statement->refcursor ){
+        /* opened by the server: only the fetch is set up */
+        OLUA_CHECK_RESULT(lua,statement);
+        type = OCI_STMT_SELECT;
+    }else{
+        status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
+                    (dvoid *)&type, (ub4 *)0, (ub4)OCI_ATTR_STMT_TYPE, statement->errhp);
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,statement->errhp,status);
+    }
+    
+    if( type == OCI_STMT_SELECT && ! statement->executing ){
+        /* a continuation keeps the options read by the first call */
+        lua_Integer fetch_size = olua_optinteger(lua,-1,"fetch_size",OLUA_DEFAULT_FETCH_SIZE);
+        ub4 prefetch = (ub4)olua_optinteger(lua,-1,"prefetch_rows",0);
+
+        statement->fetch_size  = fetch_size > 0 ? (ub4)fetch_size : 1 ;
+        statement->fetch_rows  = 0;
+        statement->fetch_index = 0;
+        statement->fetch_done  = 0;
+        statement->mode = olua_optenum(lua,-1,"mode",olua_modes,OLUA_MODE_TABLE);
+        olua_getoption(lua,-1,"reuse");
+        statement->reuse = lua_toboolean(lua,-1);
+        lua_pop(lua,1);
+        statement->date = olua_optenum(lua,-1,"date",olua_dates,OLUA_DATE_STRING);
+        olua_getoption(lua,-1,"scrollable");
+        statement->scrollable = lua_toboolean(lua,-1);
+        lua_pop(lua,1);
+        statement->generation++;
+
+        status = OCIAttrSet(statement->stmthp, OCI_HTYPE_STMT,
+                    (dvoid *)&prefetch, (ub4)0, (ub4)OCI_ATTR_PREFETCH_ROWS,
+                    statement->errhp);
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,statement->errhp,status);
+    }
+    if( ! statement->executing ){
+        /* the options of STMT:execute are for this execution only */
+        lua_pushnil(lua);
+        lua_setfield(lua,-2,"execute_options");
+    }
+    if( type == OCI_STMT_SELECT ){
+        if( statement->scrollable )
+            mode = OCI_STMT_SCROLLABLE_READONLY;
+        iters = 0;
+    }else{
+        iters = 1;
+    }
+
+    if( statement->refcursor ){
+        olua_run_start(statement);
+    }else{
+        DEBUG( puts("call OCIStmtExecute()") );
+        if( ! statement->executing ){
+            olua_run_start(statement);
+            statement->executions++;
+            if( type != OCI_STMT_SELECT ){
+                lua_getfield(lua,-1,"outs");
+                if( lua_istable(lua,-1) )
+                    olua_outbind_discard(lua,-1);
+                lua_pop(lua,1);
+            }
+        }
+        olua_nonblocking(lua,conn,1);
+        start = olua_now();
+        if( ! statement->executing )
+            statement->call_start = start;
+        while( (status = OCIStmtExecute(conn->svchp,statement->stmthp,statement->errhp,
+                            iters,0,NULL,NULL,mode)) == OCI_STILL_EXECUTING )
+        {
+            if( ! statement->sync && olua_yieldable(lua) ){
+                /* keep the statement cache from handing it to others */
+                statement->busy = 1;
+                statement->executing = 1;
+                OLUA_COUNT_TIME(statement,execute_ns,start);
+                return OLUA_YIELD(lua,olua_execute);
+            }
+            olua_sleep();
+        }
+        OLUA_COUNT_TIME(statement,execute_ns,start);
+        olua_nonblocking(lua,conn,0);
+        statement->busy = 0;
+        statement->executing = 0;
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,statement->errhp,status);
+        OLUA_COUNT(statement,executes,1);
+        if( type == OCI_STMT_SELECT )
+            olua_trace(statement,"execute",statement->call_start,0,NULL);
+    }
+    
+    if( type == OCI_STMT_SELECT ){
+        /* a statement executed again keeps its define arrays, but a
+         * cursor may be opened for another query each time */
+        if( statement->fetch_buffer == NULL || statement->refcursor ||
+            statement->fetch_alloc != statement->fetch_size )
+        {
+            olua_fetch_buffer_alloc(lua,statement);
+            lua_pushnil(lua);
+            lua_setfield(lua,-2,"rowmeta");
+            olua_setnames(lua,statement);
+        }
+        statement->busy = 1;
+        lua_pushcfunction(lua,olua_fetch);
+        lua_insert(lua,-2);
+        DEBUG( puts("LEAVE: olua_execute(OCI_STMT_SELECT)") );
+        return 2;
+    }else{
+        ub4 rowcount;
+        status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
+                    (dvoid *)&rowcount, (ub4 *)0, (ub4)OCI_ATTR_ROW_COUNT, statement->errhp);
+        if( status != OCI_SUCCESS )
+            return checkerr(lua,statement->errhp,status);
+        
+        statement->run_rows += rowcount;
+        olua_trace(statement,"execute",statement->call_start,rowcount,NULL);
+        olua_slowhook(lua,-1,statement);
+
+        lua_getfield(lua,-1,"outs");
+        if( lua_istable(lua,-1) )
+            olua_outbind_collect(lua,conn,-1,1);
+        lua_pop(lua,1);
+
+        DEBUG( puts("LEAVE: olua_execute(! OCI_STMT_SELECT)") );
+        stmt = lua_gettop(lua);
+        lua_pushinteger(lua,rowcount);
+        if( type == OCI_STMT_BEGIN || type == OCI_STMT_DECLARE )
+            return 1 + olua_pushresults(lua,stmt,statement);
+        return 1;
+    }
+}
+
+/** olua_statement_execute
+ *   STMT:execute([OPTIONS]). The fields of OPTIONS take precedence over
+ *   those of the statement-object for this execution only, so that a
+ *   cached statement runs the next `CONN:exec` with its own options.
+ * stack-in:
+ *   (+1) statement-handle
+ *   (+2) option-table (optional)
+ */
+static int olua_statement_execute(lua_State *lua)
+{
+    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
+
+    if( lua_istable(lua,2) && ! statement->executing ){
+        lua_pushvalue(lua,2);
+        lua_setfield(lua,1,"execute_options");
+    }
+    lua_settop(lua,1);
+    return olua_execute(lua);
+}
+
+/** olua_fetch_call
+ *   call OCIStmtFetch2 for `nrows` rows (up to fetch_alloc) in the
+ *   orientation, and make them the rows held in the define arrays.
+ *   When `pending` is given and the fetch is still executing in a
+ *   coroutine, *pending is set and 0 is returned to yield.
+ * return
+ *   the number of rows fetched
+ */
+static ub4 olua_fetch_call(lua_State *lua,struct olua_statement *statement,
+    ub4 nrows,ub2 orientation,sb4 offset,int *pending)
+{
+    unsigned long long start;
+    sword status;
+    ub4 rows=0;
+
+    OLUA_CHECK_RESULT(lua,statement);
+    olua_nonblocking(lua,statement->conn,1);
+    start = olua_now();
+    if( ! statement->fetching )
+        statement->call_start = start;
+    while( (status = OCIStmtFetch2(
+                statement->stmthp ,
+                statement->errhp ,
+                nrows ,
+                orientation ,
+                offset ,
+                OCI_DEFAULT )) == OCI_STILL_EXECUTING )
+    {
+        if( pending != NULL && olua_yieldable(lua) ){
+            *pending = 1;
+            statement->fetching = 1;
+            OLUA_COUNT_TIME(statement,fetch_ns,start);
+            return 0;
+        }
+        olua_sleep();
+    }
+    OLUA_COUNT_TIME(statement,fetch_ns,start);
+    OLUA_COUNT(statement,fetches,1);
+    statement->fetching = 0;
+    olua_nonblocking(lua,statement->conn,0);
+
+    if( status == OCI_NO_DATA ){
+        statement->fetch_done = 1;
+    }else if( status != OCI_SUCCESS ){
+        checkerr(lua,statement->errhp,status);
+        return 0;
+    }
+
+    /* on OCI_NO_DATA, the last partial batch may still have arrived. */
+    status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
+                (dvoid *)&rows, (ub4 *)0, (ub4)OCI_ATTR_ROWS_FETCHED, statement->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,statement->errhp,status);
+
+    DEBUG( printf("olua_fetch_call: %u rows\n",rows) );
+    OLUA_COUNT(statement,rows,rows);
+    statement->run_rows += rows;
+    olua_trace(statement,"fetch",statement->call_start,rows,NULL);
+    statement->fetch_rows  = rows;
+    statement->fetch_index = 0;
+    statement->generation++;
+    return rows;
+}
+
+/** olua_fetch_batch
+ *   refill the define arrays with the next `fetch_size` rows when all
+ *   rows fetched before have been handed out.
+ *   When `pending` is given and the fetch is still executing in a
+ *   coroutine, *pending is set and 0 is returned to yield.
+ * return
+ *   the number of rows not handed out yet (0 at the end of the cursor)
+ */
+static ub4 olua_fetch_batch(lua_State *lua,struct olua_statement *statement,int *pending)
+{
+    if( statement->fetch_index < statement->fetch_rows )
+        return statement->fetch_rows - statement->fetch_index;
+    if( statement->fetch_done )
+        return 0;
+    return olua_fetch_call(lua,statement,statement->fetch_size,OCI_FETCH_NEXT,0,pending);
+}
+
+/* A DATE or TIMESTAMP value decoded from the define buffer. */
+struct olua_datetime {
+    int year, month, day, hour, min, sec;
+    ub4 nsec;
+    int tz;        /* offset from UTC in minutes */
+    int has_nsec;  /* TIMESTAMP */
+    int has_tz;    /* TIMESTAMP WITH (LOCAL) TIME ZONE */
+};
+
+/* 7 bytes of SQLT_DAT: century+100, year+100, month, day, hour+1, minute+1, second+1 */
+static void olua_decode_date(const ub1 *p,struct olua_datetime *dt)
+{
+    dt->year  = ((int)p[0]-100)*100 + ((int)p[1]-100);
+    dt->month = p[2];
+    dt->day   = p[3];
+    dt->hour  = p[4]-1;
+    dt->min   = p[5]-1;
+    dt->sec   = p[6]-1;
+    dt->nsec  = 0;
+    dt->tz    = 0;
+    dt->has_nsec = 0;
+    dt->has_tz   = 0;
+}
+
+static void olua_decode_timestamp(
+    OCIEnv *envhp ,
+    OCIError *errhp ,
+    OCIDateTime *datetime ,
+    int has_tz ,
+    struct olua_datetime *dt )
+{
+    sb2 year=0;
+    ub1 month=0, day=0, hour=0, min=0, sec=0;
+    ub4 fsec=0;
+    sb1 tzh=0, tzm=0;
+
+    OCIDateTimeGetDate(envhp,errhp,datetime,&year,&month,&day);
+    OCIDateTimeGetTime(envhp,errhp,datetime,&hour,&min,&sec,&fsec);
+    if( has_tz )
+        OCIDateTimeGetTimeZoneOffset(envhp,errhp,datetime,&tzh,&tzm);
+    dt->year  = year;
+    dt->month = month;
+    dt->day   = day;
+    dt->hour  = hour;
+    dt->min   = min;
+    dt->sec   = sec;
+    dt->nsec  = fsec;
+    dt->tz    = tzh*60 + (tzh < 0 ? -tzm : tzm);
+    dt->has_nsec = 1;
+    dt->has_tz   = has_tz;
+}
+
+/* days from 1970-01-01 of the proleptic Gregorian date */
+static long olua_days_from_civil(long y,int m,int d)
+{
+    long era;
+    long yoe, doy, doe;
+
+    y -= (m <= 2);
+    era = (y >= 0 ? y : y-399) / 400;
+    yoe = y - era * 400;
+    doy = (153*(m > 2 ? m-3 : m+9) + 2)/5 + d-1;
+    doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/* olua_formatdatetime
+ *   'YYYY/MM/DD HH24:MI:SS[.FF6][ +TZH:TZM]' into buffer (48 bytes)
+ * return
+ *   the length
+ */
+static size_t olua_formatdatetime(char *buffer,const struct olua_datetime *dt)
+{
+    size_t len;
+
+    len = sprintf(buffer,"%04d/%02d/%02d %02d:%02d:%02d",
+            dt->year,dt->month,dt->day,dt->hour,dt->min,dt->sec);
+    if( dt->has_nsec )
+        len += sprintf(buffer+len,".%06u",(unsigned)(dt->nsec/1000));
+    if( dt->has_tz ){
+        int tz = dt->tz < 0 ? -dt->tz : dt->tz ;
+        len += sprintf(buffer+len," %c%02d:%02d",dt->tz < 0 ? '-' : '+',tz/60,tz%60);
+    }
+    return len;
+}
+
+/* olua_pushdatetime
+ *   OLUA_DATE_STRING: 'YYYY/MM/DD HH24:MI:SS[.FF6][ +TZH:TZM]'
+ *   OLUA_DATE_EPOCH : seconds from 1970-01-01 00:00:00 UTC. values
+ *                     without time zone are taken as UTC.
+ *   OLUA_DATE_TABLE : { year,month,day,hour,min,sec[,nsec][,tz] }
+ *                     same fields as os.time() and os.date('*t').
+ */
+static void olua_pushdatetime(lua_State *lua,int mode,const struct olua_datetime *dt)
+{
+    char buffer[48];
+    size_t len;
+    double epoch;
+
+    switch( mode ){
+    case OLUA_DATE_EPOCH:
+        epoch = (double)olua_days_from_civil(dt->year,dt->month,dt->day) * 86400.0
+              + dt->hour*3600 + dt->min*60 + dt->sec - dt->tz*60 ;
+        if( dt->nsec != 0 )
+            lua_pushnumber(lua,epoch + dt->nsec / 1e9);
+        else
+            olua_pushint64(lua,(sb8)epoch);
+        break;
+    case OLUA_DATE_TABLE:
+        lua_createtable(lua,0,8);
+        lua_pushinteger(lua,dt->year);
+        lua_setfield(lua,-2,"year");
+        lua_pushinteger(lua,dt->month);
+        lua_setfield(lua,-2,"month");
+        lua_pushinteger(lua,dt->day);
+        lua_setfield(lua,-2,"day");
+        lua_pushinteger(lua,dt->hour);
+        lua_setfield(lua,-2,"hour");
+        lua_pushinteger(lua,dt->min);
+        lua_setfield(lua,-2,"min");
+        lua_pushinteger(lua,dt->sec);
+        lua_setfield(lua,-2,"sec");
+        if( dt->has_nsec ){
+            lua_pushinteger(lua,dt->nsec);
+            lua_setfield(lua,-2,"nsec");
+        }
+        if( dt->has_tz ){
+            lua_pushinteger(lua,dt->tz);
+            lua_setfield(lua,-2,"tz");
+        }
+        break;
+    default:
+        len = olua_formatdatetime(buffer,dt);
+        lua_pushlstring(lua,buffer,len);
+        break;
+    }
+}
+
+#define OLUA_CELL(fetch_buffer,row) \
+    ( (fetch_buffer)->u.string + (size_t)(fetch_buffer)->size * (row) )
+
+static void olua_decode_string(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    lua_pushlstring(lua,OLUA_CELL(fetch_buffer,row),fetch_buffer->len[row]);
+}
+
+static void olua_decode_int64(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    olua_pushint64(lua,*(sb8*)OLUA_CELL(fetch_buffer,row));
+}
+
+static void olua_decode_int(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    lua_pushinteger(lua,*(int*)OLUA_CELL(fetch_buffer,row));
+}
+
+static void olua_decode_double(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    lua_pushnumber(lua,*(double*)OLUA_CELL(fetch_buffer,row));
+}
+
+static void olua_decode_dat(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    struct olua_datetime dt;
+
+    olua_decode_date((ub1*)OLUA_CELL(fetch_buffer,row),&dt);
+    olua_pushdatetime(lua,statement->date,&dt);
+}
+
+static void olua_decode_ts(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    struct olua_datetime dt;
+
+    olua_decode_timestamp(statement->envhp,statement->errhp,
+        *(OCIDateTime**)OLUA_CELL(fetch_buffer,row),
+        fetch_buffer->type == SQLT_TIMESTAMP_TZ ,&dt);
+    olua_pushdatetime(lua,statement->date,&dt);
+}
+
+static void olua_decode_lob(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    /* the locator of the define array is overwritten by the next
+     * fetch, so the lob-object has its own copy. */
+    lua_getfield(lua,stmt,"connection");
+    lua_getfield(lua,-1,"handle");
+    olua_lob_new(lua,-1,*(OCILobLocator**)OLUA_CELL(fetch_buffer,row),(ub1)fetch_buffer->type);
+    lua_replace(lua,-3);
+    lua_pop(lua,1);
+}
+
+static void olua_decode_nil(lua_State *lua,int stmt,struct olua_statement *statement,
+    struct olua_fetch_buffer *fetch_buffer,ub4 row)
+{
+    lua_pushnil(lua);
+}
+
+/* olua_decoder_for
+ *   choose the decoder of the column by its type of the define array.
+ */
+static olua_decoder olua_decoder_for(struct olua_fetch_buffer *fetch_buffer)
+{
+    switch( fetch_buffer->type ){
+    case SQLT_STR:
+    case SQLT_CHR:
+    case SQLT_VCS:
+    case SQLT_AFC:
+        return olua_decode_string;
+    case SQLT_INT:
+        return fetch_buffer->size == sizeof(sb8) ? olua_decode_int64 : olua_decode_int;
+    /* case SQLT_BDOUBLE: */
+    /* case SQLT_BFLOAT: */
+    case SQLT_FLT:
+        return olua_decode_double;
+    case SQLT_DAT:
+        return olua_decode_dat;
+    case SQLT_TIMESTAMP:
+    case SQLT_TIMESTAMP_TZ:
+        return olua_decode_ts;
+    case SQLT_CLOB:
+    case SQLT_BLOB:
+        return olua_decode_lob;
+    case SQLT_ODT:
+    case SQLT_DATE:
+    case SQLT_TIMESTAMP_LTZ:
+    default:
+        return olua_decode_nil;
+    }
+}
+
+/* olua_pushcolumn
+ *   push the value of the column at the row `row` of the define arrays.
+ *   NULL is pushed as the option `null` of the connection or false.
+ *   stack-in:
+ *     (stmt) statement-object
+ *   return
+ *     the bytes of the value (0 for NULL), for the counter `bytes`
+ */
+static ub4 olua_pushcolumn(
+    lua_State *lua ,
+    int stmt ,
+    struct olua_statement *statement ,
+    struct olua_fetch_buffer *fetch_buffer ,
+    ub4 row )
+{
+    if( fetch_buffer->ind[row] != 0 ){ /* NULL VALUE */
+        if( statement->conn->null_ref != LUA_NOREF )
+            lua_rawgeti(lua,LUA_REGISTRYINDEX,statement->conn->null_ref);
+        else
+            lua_pushboolean(lua,0);
+        return 0;
+    }
+    fetch_buffer->decode(lua,stmt,statement,fetch_buffer,row);
+    return fetch_buffer->len[row];
+}
+
+/* olua_fillrow
+ *   store the row `row` of the define arrays into the table on the top
+ *   under the column numbers, and also under the column names if `named`.
+ */
+static void olua_fillrow(lua_State *lua,int stmt,struct olua_statement *statement,ub4 row,int named)
+{
+    int t=lua_gettop(lua);
+    int names=0;
+    unsigned long long bytes=0;
+    int c;
+
+    if( named ){
+        lua_getfield(lua,stmt,"names");
+        names = lua_gettop(lua);
+    }
+    for( c=0 ; c < statement->ncols ; c++ ){
+        bytes += olua_pushcolumn(lua,stmt,statement,&statement->fetch_buffer[c],row);
+        if( named ){
+            lua_rawgeti(lua,names,c+1);
+            lua_pushvalue(lua,-2);
+            lua_rawset(lua,t);
+        }
+        lua_rawseti(lua,t,c+1);
+    }
+    lua_settop(lua,t);
+    OLUA_COUNT(statement,bytes,bytes);
+}
+
+/* olua_pushrow
+ *   push a new table of the row `row` of the define arrays, which has
+ *   each value under both the column number and the column name.
+ */
+static void olua_pushrow(lua_State *lua,int stmt,struct olua_statement *statement,ub4 row)
+{
+    lua_createtable(lua,statement->ncols,statement->ncols);
+    olua_fillrow(lua,stmt,statement,row,1);
+}
+
+/* A row of mode="lazy": a view of the define arrays which converts
+ * a column only when it is read. Its user-value is the statement-object.
+ */
+struct olua_row {
+    struct olua_statement *statement;
+    ub4 row;
+    unsigned long generation;
+};
+
+static struct olua_row *olua_row_check(lua_State *lua)
+{
+    struct olua_row *r=lua_touserdata(lua,1);
+
+    luaL_argcheck(lua,r != NULL,1,"not a row");
+    if( r->generation != r->statement->generation || r->statement->fetch_buffer == NULL )
+        luaL_error(lua,"the row is no longer valid (use row:copy() to keep it)");
+    return r;
+}
+
+/* lua-function: olua_row_copy
+ *  stack-in
+ *    (+1) row
+ *  return
+ *    (+1) table same as mode="table"
+ */
+static int olua_row_copy(lua_State *lua)
+{
+    struct olua_row *r=olua_row_check(lua);
+
+    lua_getuservalue(lua,1);
+    olua_pushrow(lua,lua_gettop(lua),r->statement,r->row);
+    return 1;
+}
+
+/* lua-function: olua_row_index
+ *  stack-in
+ *    (+1) row
+ *    (+2) column number or column name
+ *  upvalue
+ *    (1) table: column name => column number
+ */
+static int olua_row_index(lua_State *lua)
+{
+    struct olua_row *r=olua_row_check(lua);
+    lua_Integer n;
+
+    if( lua_type(lua,2) == LUA_TNUMBER ){
+        n = lua_tointeger(lua,2);
+    }else{
+        lua_pushvalue(lua,2);
+        lua_rawget(lua,lua_upvalueindex(1));
+        if( lua_isnil(lua,-1) ){
+            if( lua_type(lua,2) == LUA_TSTRING && strcmp(lua_tostring(lua,2),"copy")==0 )
+                lua_pushcfunction(lua,olua_row_copy);
+            return 1;
+        }
+        n = lua_tointeger(lua,-1);
+        lua_pop(lua,1);
+    }
+    if( n < 1 || n > r->statement->ncols ){
+        lua_pushnil(lua);
+        return 1;
+    }
+    lua_getuservalue(lua,1);
+    OLUA_COUNT(r->statement,bytes,
+        olua_pushcolumn(lua,lua_gettop(lua),r->statement,&r->statement->fetch_buffer[n-1],r->row));
+    return 1;
+}
+
+static int olua_row_len(lua_State *lua)
+{
+    struct olua_row *r=olua_row_check(lua);
+
+    lua_pushinteger(lua,r->statement->ncols);
+    return 1;
+}
+
+/* olua_pushrowview
+ *   push a row of mode="lazy". The metatable is made once per statement
+ *   and kept in its member `rowmeta`, with the column name lookup.
+ */
+static void olua_pushrowview(lua_State *lua,int stmt,struct olua_statement *statement,ub4 row)
+{
+    struct olua_row *r;
+
+    r = lua_newuserdata(lua,sizeof(struct olua_row));
+    r->statement = statement;
+    r->row = row;
+    r->generation = statement->generation;
+
+    lua_getfield(lua,stmt,"rowmeta");
+    if( lua_isnil(lua,-1) ){
+        int c;
+
+        lua_pop(lua,1);
+        lua_createtable(lua,0,3);
+        lua_createtable(lua,0,statement->ncols);
+        for( c=0 ; c < statement->ncols ; c++ ){
+            lua_pushinteger(lua,c+1);
+            lua_setfield(lua,-2,statement->fetch_buffer[c].name);
+        }
+        lua_pushcclosure(lua,olua_row_index,1);
+        lua_setfield(lua,-2,"__index");
+        lua_pushcfunction(lua,olua_row_len);
+        lua_setfield(lua,-2,"__len");
+        lua_pushvalue(lua,-1);
+        lua_setfield(lua,stmt,"rowmeta");
+    }
+    lua_setmetatable(lua,-2);
+    lua_pushvalue(lua,stmt);
+    lua_setuservalue(lua,-2);
+}
+
+/* olua_fetch_end
+ *   the cursor at stack (+1) reached the end: release it and push nil.
+ */
+static int olua_fetch_end(lua_State *lua,struct olua_statement *statement)
+{
+    /* the statement cache keeps handles and buffers for the next exec */
+    statement->busy = 0;
+    /* a cursor stays bound to the PL/SQL which opens it again */
+    if( ! statement->cached && ! statement->refcursor )
+        olua_statement_gc(lua);
+    /* last: an error raised by the hook leaves nothing held */
+    olua_slowhook(lua,1,statement);
+    lua_pushnil(lua);
+    return 1;
+}
+
+OLUA_CONTINUATION(olua_fetch)
+
+/** olua_fetch 
+ *
+ * stack-in:
+ *   (+1) statement-handle
+ * stack-out:
+ *   (+1) column table.
+ */
+static int olua_fetch(lua_State *lua)
+{
+    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
+    int pending=0;
+    ub4 row;
+
+    DEBUG( puts("ENTER: olua_fetch()") );
+
+    if( statement == NULL )
+        return luaL_error(lua,"error: invalid parameter(statement==NULL)");
+
+    if( statement->stmthp == NULL || olua_fetch_batch(lua,statement,&pending) == 0 ){
+        if( pending )
+            return OLUA_YIELD(lua,olua_fetch);
+        return olua_fetch_end(lua,statement);
+    }
+    row = statement->fetch_index++;
+    
+    DEBUG( puts("push fetch values") );
+    DEBUG( fflush(stdout) );
+
+    if( statement->mode == OLUA_MODE_LAZY ){
+        olua_pushrowview(lua,1,statement,row);
+    }else{
+        if( statement->reuse ){
+            lua_getfield(lua,1,"row");
+            if( ! lua_istable(lua,-1) ){
+                lua_pop(lua,1);
+                lua_newtable(lua);
+                lua_pushvalue(lua,-1);
+                lua_setfield(lua,1,"row");
+            }
+        }else if( statement->mode == OLUA_MODE_ARRAY ){
+            lua_createtable(lua,statement->ncols,0);
+        }else{
+            lua_createtable(lua,statement->ncols,statement->ncols);
+        }
+        olua_fillrow(lua,1,statement,row,statement->mode != OLUA_MODE_ARRAY);
+    }
+
+    DEBUG( puts("LEAVE: olua_fetch(successfully)") );
+    return 1;
+}
+
+
+/* olua_pushbatchrow
+ *   push a row of the array of rows returned at once. mode="array" makes
+ *   arrays, and the others (also "lazy") make tables with the names.
+ */
+static void olua_pushbatchrow(lua_State *lua,int stmt,struct olua_statement *statement,ub4 row)
+{
+    if( statement->mode == OLUA_MODE_ARRAY ){
+        lua_createtable(lua,statement->ncols,0);
+        olua_fillrow(lua,stmt,statement,row,0);
+    }else{
+        olua_pushrow(lua,stmt,statement,row);
+    }
+}
+
+/* olua_fetch_scroll
+ *   fetch `count` rows of the scrollable cursor from the row given by
+ *   the orientation and the offset. The iterator goes on after them.
+ * stack-in:
+ *   (+1) statement-handle
+ *   (+2) row number (OCI_FETCH_ABSOLUTE) or offset (OCI_FETCH_RELATIVE)
+ *   (+3) number of rows (optional: fetch_size)
+ * stack-out:
+ *   (+1) array of rows (empty beyond the end)
+ */
+static int olua_fetch_scroll(lua_State *lua,ub2 orientation)
+{
+    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
+    lua_Integer offset=luaL_checkinteger(lua,2);
+    lua_Integer count=luaL_optinteger(lua,3,statement->fetch_size);
+    lua_Integer n=0;
+
+    luaL_argcheck(lua,statement->stmthp != NULL && statement->fetch_buffer != NULL &&
+                      statement->scrollable,1,"not executed with scrollable=true");
+    luaL_argcheck(lua,orientation != OCI_FETCH_ABSOLUTE || offset >= 1,2,
+                      "row number must be 1 or more");
+    lua_settop(lua,1);
+    lua_createtable(lua,(int)(count > 0 && count < 65536 ? count : 0),0);
+
+    while( n < count ){
+        ub4 nrows=statement->fetch_alloc;
+        ub4 rows,r;
+
+        if( (lua_Integer)nrows > count - n )
+            nrows = (ub4)(count - n);
+        rows = olua_fetch_call(lua,statement,nrows,orientation,(sb4)offset,NULL);
+        for( r=0 ; r < rows ; r++ ){
+            olua_pushbatchrow(lua,1,statement,r);
+            lua_rawseti(lua,2,(int)++n);
+        }
+        statement->fetch_index = rows;
+        if( rows < nrows )
+            break;
+        /* the rest follows the rows just fetched */
+        orientation = OCI_FETCH_NEXT;
+        offset = 0;
+    }
+    /* the end here does not close the cursor, which can scroll back */
+    statement->fetch_done = 0;
+    return 1;
+}
+
+/* STMT:fetch_absolute(N[,COUNT]): COUNT rows from the N-th row */
+static int olua_fetch_absolute(lua_State *lua)
+{
+    return olua_fetch_scroll(lua,OCI_FETCH_ABSOLUTE);
+}
+
+/* STMT:fetch_relative(N[,COUNT]): COUNT rows from N rows after the last
+ * row fetched (1 is the next row, 0 the same row) */
+static int olua_fetch_relative(lua_State *lua)
+{
+    return olua_fetch_scroll(lua,OCI_FETCH_RELATIVE);
+}
+
+
+/** olua_fetchcolumns
+ *
+ * stack-in:
+ *   (+1) statement-handle
+ *   (+2) maximum number of rows (optional: all rows)
+ * stack-out:
+ *   (+1) table of arrays of column values under both the column number
+ *        and the column name, or nil at the end.
+ *   (+2) number of rows
+ */
+static int olua_fetchcolumns(lua_State *lua)
+{
+    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
+    lua_Integer limit=luaL_optinteger(lua,2,0);
+    lua_Integer count=0;
+    ub4 avail;
+    int c;
+
+    lua_settop(lua,1);
+    if( statement->stmthp == NULL || statement->fetch_buffer == NULL ||
+        (avail=olua_fetch_batch(lua,statement,NULL)) == 0 )
+    {
+        return olua_fetch_end(lua,statement);
+    }
+    luaL_checkstack(lua,statement->ncols+2,"too many columns");
+
+    /* stack: 1:statement 2:result 3..:column arrays */
+    lua_createtable(lua,statement->ncols,statement->ncols);
+    for( c=0 ; c < statement->ncols ; c++ ){
+        lua_createtable(lua,(int)(limit > 0 && limit < 65536 ? limit : avail),0);
+        lua_pushvalue(lua,-1);
+        lua_setfield(lua,2,statement->fetch_buffer[c].name);
+        lua_pushvalue(lua,-1);
+        lua_rawseti(lua,2,c+1);
+    }
+
+    while( (limit <= 0 || count < limit) && (avail=olua_fetch_batch(lua,statement,NULL)) > 0 ){
+        ub4 first=statement->fetch_index;
+        ub4 n=avail;
+        ub4 r;
+        unsigned long long bytes=0;
+
+        if( limit > 0 && n > (ub4)(limit-count) )
+            n = (ub4)(limit-count);
+
+        for( c=0 ; c < statement->ncols ; c++ ){
+            for( r=0 ; r < n ; r++ ){
+                bytes += olua_pushcolumn(lua,1,statement,&statement->fetch_buffer[c],first+r);
+                lua_rawseti(lua,c+3,(int)(count+r+1));
+            }
+        }
+        OLUA_COUNT(statement,bytes,bytes);
+        statement->fetch_index += n;
+        count += n;
+    }
+    lua_settop(lua,2);
+    if( statement->fetch_done && statement->fetch_index >= statement->fetch_rows ){
+        /* drained: release the cursor as olua_fetch_end does */
+        statement->busy = 0;
+        if( ! statement->cached && ! statement->refcursor )
+            olua_statement_gc(lua);
+        olua_slowhook(lua,1,statement);
+    }
+    lua_pushinteger(lua,count);
+    return 2;
+}
+
+/** olua_exec
+ *
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) sql string
+ *   (+3) bind values
+ * stack-out
+ *   (+1) iterator(fetch-function)
+ *   (+2) statement-handle
+ */
+static void olua_exec_prepare(lua_State *lua,int bindvars);
+
+static int olua_exec(lua_State *lua)
+{
+    int bindvars=lua_gettop(lua)-2;
+
+    olua_exec_prepare(lua,bindvars);
+
+    DEBUG( printf("stack=%d (before bind)\n",lua_gettop(lua) ) );
+
+    /* +1 statement-handle
+     *  : binds
+     */
+    assert( lua_gettop(lua) == bindvars + 1 );
+    olua_bind_core(lua,bindvars);
+    if( lua_isnil(lua,-1) )
+        return 1;
+    lua_settop(lua,1);
+
+    /* +1 statement-handle */
+    assert( lua_gettop(lua) == 1 );
+
+    return olua_execute(lua);
+}
+
+/** olua_page
+ *   one page of the result of the SELECT: the SQL is run with
+ *   "OFFSET :olua_offset ROWS FETCH NEXT :olua_limit ROWS ONLY" added,
+ *   whose binds keep the text the same for all pages, so the cursor
+ *   comes from the statement cache. The rows are prefetched by the
+ *   execution, which makes a page one round-trip.
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) sql string
+ *   (+3) table of bind values: an array by position, or by name (or nil)
+ *   (+4) number of rows skipped
+ *   (+5) number of rows of the page
+ * stack-out
+ *   (+1) array of rows
+ */
+static int olua_page(lua_State *lua)
+{
+    struct olua_statement *statement;
+    lua_Integer offset=luaL_checkinteger(lua,4);
+    lua_Integer limit=luaL_checkinteger(lua,5);
+    lua_Integer count=0;
+    const char *sql;
+    size_t sql_len;
+    luaL_Buffer b;
+    int bindvars,named,i,n;
+    ub4 avail,r;
+
+    (void)olua_tohandle(lua,1,TNAME_CONNECTION);
+    sql = luaL_checklstring(lua,2,&sql_len);
+    luaL_argcheck(lua,lua_isnoneornil(lua,3) || lua_istable(lua,3),3,"table expected");
+    luaL_argcheck(lua,offset >= 0,4,"offset must be 0 or more");
+    luaL_argcheck(lua,limit >= 1,5,"limit must be 1 or more");
+    lua_settop(lua,3);
+
+    while( sql_len > 0 && strchr(" \t\r\n;",sql[sql_len-1]) != NULL )
+        sql_len--;
+    luaL_buffinit(lua,&b);
+    luaL_addlstring(&b,sql,sql_len);
+    luaL_addstring(&b,"\nOFFSET :olua_offset ROWS FETCH NEXT :olua_limit ROWS ONLY");
+    luaL_pushresult(&b);
+    lua_replace(lua,2);
+
+    /* +1 connection
+     * +2 sql with OFFSET and FETCH
+     * +3... binds, and the offset and the limit
+     */
+    n = lua_istable(lua,3) ? (int)lua_rawlen(lua,3) : 0;
+    named = 0;
+    if( n == 0 && lua_istable(lua,3) ){
+        lua_pushnil(lua);
+        if( lua_next(lua,3) ){
+            lua_pop(lua,2);
+            named = 1;
+        }
+    }
+    if( named ){
+        /* by name: a copy with olua_offset and olua_limit */
+        lua_newtable(lua);
+        lua_pushnil(lua);
+        while( lua_next(lua,3) ){
+            lua_pushvalue(lua,-2);
+            lua_insert(lua,-2);
+            lua_rawset(lua,4);
+        }
+        lua_pushinteger(lua,offset);
+        lua_setfield(lua,4,"olua_offset");
+        lua_pushinteger(lua,limit);
+        lua_setfield(lua,4,"olua_limit");
+        bindvars = 1;
+    }else{
+        luaL_checkstack(lua,n+2,"too many binds");
+        for( i=1 ; i <= n ; i++ )
+            lua_rawgeti(lua,3,i);
+        lua_pushinteger(lua,offset);
+        lua_pushinteger(lua,limit);
+        bindvars = n+2;
+    }
+    lua_remove(lua,3);
+
+    olua_exec_prepare(lua,bindvars);
+    statement = olua_tohandle(lua,1,TNAME_STATEMENT);
+    /* run by this C function, which can not yield */
+    statement->sync = 1;
+    /* the options of the page, not kept by the cached statement */
+    lua_createtable(lua,0,3);
+    lua_pushinteger(lua,limit);
+    lua_setfield(lua,-2,"fetch_size");
+    lua_pushinteger(lua,limit);
+    lua_setfield(lua,-2,"prefetch_rows");
+    lua_pushboolean(lua,0);
+    lua_setfield(lua,-2,"scrollable");
+    lua_setfield(lua,1,"execute_options");
+    olua_bind_core(lua,bindvars);
+    lua_settop(lua,1);
+    n = olua_execute(lua);
+    statement->sync = 0;
+    if( n != 2 )
+        return luaL_error(lua,"page: not a SELECT statement");
+
+    /* drop the iterator: 1:statement */
+    lua_remove(lua,-2);
+    lua_settop(lua,1);
+    lua_createtable(lua,(int)(limit < 65536 ? limit : 0),0);
+    while( count < limit && (avail=olua_fetch_batch(lua,statement,NULL)) > 0 ){
+        ub4 first=statement->fetch_index;
+
+        if( (lua_Integer)avail > limit - count )
+            avail = (ub4)(limit - count);
+        for( r=0 ; r < avail ; r++ ){
+            olua_pushbatchrow(lua,1,statement,first+r);
+            lua_rawseti(lua,2,(int)++count);
+        }
+        statement->fetch_index += avail;
+    }
+    statement->busy = 0;
+    olua_slowhook(lua,1,statement);
+    return 1;
+}
+
+/* olua_exec_prepare
+ *   replace the connection and the SQL with the statement-object from the
+ *   statement cache, or prepared now and put into the cache.
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) sql string
+ *   (+3) bind values
+ * stack-out
+ *   (+1) statement-handle
+ *   (+2) bind values
+ */
+static void olua_exec_prepare(lua_State *lua,int bindvars)
+{
+    const char *sql;
+    size_t sql_len;
+    int handle;
+
+    /* +1 connection
+     * +2 sql
+     * +3... binds
+     */
+    DEBUG( printf("stack=%d (before prepare)\n",lua_gettop(lua) ) );
+
+    sql = luaL_checklstring(lua,2,&sql_len);
+    (void)olua_tohandle(lua,1,TNAME_CONNECTION);
+    lua_getfield(lua,1,"handle");
+    handle = lua_gettop(lua);
+
+    if( olua_stmtcache_get(lua,handle,sql,sql_len,olua_countbinds(lua,3,bindvars)) ){
+        lua_remove(lua,handle);
+    }else{
+        lua_pop(lua,1);
+        olua_prepare(lua);
+        lua_getfield(lua,1,"handle");
+        lua_insert(lua,-2);
+        olua_stmtcache_put(lua,-2,sql,sql_len);
+        lua_remove(lua,-2);
+    }
+
+    /* +1 connection  => DEL
+     * +2 sql string  => DEL
+     *  : bind-values
+     * -1 statement-object
+     */
+    assert( lua_gettop(lua) == bindvars + 3 );
+
+    lua_remove(lua,+2); /* del: sql(original) */
+    lua_remove(lua,+1); /* del: connection(original) */
+    lua_insert(lua,+1); /* mov: statement-handle */
+}
+
+/* olua_tofile
+ *   the FILE of the filename or the opened file-handle at `index`.
+ *   *close is set when the file is opened here.
+ */
+static FILE *olua_tofile(lua_State *lua,int index,const char *mode,int *close,const char *who)
+{
+    luaL_Stream *stream;
+    FILE *fp;
+
+    *close = 0;
+    if( lua_type(lua,index) == LUA_TSTRING ){
+        if( (fp = fopen(lua_tostring(lua,index),mode)) == NULL )
+            luaL_error(lua,"%s: can not open %s",who,lua_tostring(lua,index));
+        *close = 1;
+        return fp;
+    }
+    stream = luaL_testudata(lua,index,LUA_FILEHANDLE);
+    if( stream == NULL || stream->closef == NULL )
+        luaL_error(lua,"%s: file must be a filename or an opened file-handle",who);
+    if( mode[0] == 'w' )
+        fflush( stream->f );
+    return stream->f;
+}
+
+/* State of CONN:export. The output buffer follows the structure in the
+ * same userdata, and the garbage collector closes the file on errors.
+ */
+struct olua_export {
+    FILE *fp;
+    int close;            /* fp was opened by export */
+    int tsv;              /* escape with backslash instead of quoting */
+    char delimiter;
+    char quote;           /* '\0' never quotes */
+    const char *null;     /* text of NULL (kept alive by the option-table) */
+    size_t null_len;
+    size_t len;
+    size_t size;
+    unsigned long long bytes;
+    char buffer[1];
+};
+
+#define OLUA_EXPORT_BUFFER 65536
+
+static int olua_export_gc(lua_State *lua)
+{
+    struct olua_export *ex=lua_touserdata(lua,1);
+
+    if( ex->fp != NULL && ex->close )
+        fclose(ex->fp);
+    ex->fp = NULL;
+    return 0;
+}
+
+static void olua_export_flush(lua_State *lua,struct olua_export *ex)
+{
+    if( ex->len > 0 && fwrite(ex->buffer,1,ex->len,ex->fp) != ex->len )
+        luaL_error(lua,"export: write error");
+    ex->bytes += ex->len;
+    ex->len = 0;
+}
+
+static void olua_export_put(lua_State *lua,struct olua_export *ex,const char *p,size_t len)
+{
+    if( ex->len + len > ex->size ){
+        olua_export_flush(lua,ex);
+        if( len > ex->size ){
+            if( fwrite(p,1,len,ex->fp) != len )
+                luaL_error(lua,"export: write error");
+            ex->bytes += len;
+            return;
+        }
+    }
+    memcpy(ex->buffer + ex->len , p , len);
+    ex->len += len;
+}
+
+#define olua_export_putc(lua,ex,c) \
+    ( (ex)->len < (ex)->size ? (void)((ex)->buffer[(ex)->len++] = (c)) \
+                             : (olua_export_flush(lua,ex),(void)((ex)->buffer[(ex)->len++] = (c))) )
+
+/* olua_export_text
+ *   put a part of a text field. `quoted` tells the field is in quotes.
+ */
+static void olua_export_text(lua_State *lua,struct olua_export *ex,const char *p,size_t len,int quoted)
+{
+    size_t i;
+
+    if( ex->tsv ){
+        for( i=0 ; i < len ; i++ ){
+            switch( p[i] ){
+            case '\t': olua_export_putc(lua,ex,'\\'); olua_export_putc(lua,ex,'t'); break;
+            case '\n': olua_export_putc(lua,ex,'\\'); olua_export_putc(lua,ex,'n'); break;
+            case '\r': olua_export_putc(lua,ex,'\\'); olua_export_putc(lua,ex,'r'); break;
+            case '\\': olua_export_putc(lua,ex,'\\'); olua_export_putc(lua,ex,'\\'); break;
+            default:   olua_export_putc(lua,ex,p[i]); break;
+            }
+        }
+    }else if( quoted && memchr(p,ex->quote,len) != NULL ){
+        for( i=0 ; i < len ; i++ ){
+            if( p[i] == ex->quote )
+                olua_export_putc(lua,ex,ex->quote);
+            olua_export_putc(lua,ex,p[i]);
+        }
+    }else{
+        olua_export_put(lua,ex,p,len);
+    }
+}
+
+/* olua_export_field
+ *   put a whole text field, in quotes when it has the delimiter,
+ *   the quote or a newline.
+ */
+static void olua_export_field(lua_State *lua,struct olua_export *ex,const char *p,size_t len)
+{
+    size_t i;
+
+    if( ex->tsv || ex->quote == '\0' ){
+        olua_export_text(lua,ex,p,len,0);
+        return;
+    }
+    for( i=0 ; i < len ; i++ ){
+        char c=p[i];
+        if( c == ex->delimiter || c == ex->quote || c == '\n' || c == '\r' )
+            break;
+    }
+    if( i >= len ){
+        olua_export_put(lua,ex,p,len);
+        return;
+    }
+    olua_export_putc(lua,ex,ex->quote);
+    olua_export_text(lua,ex,p,len,1);
+    olua_export_putc(lua,ex,ex->quote);
+}
+
+/* olua_export_lob
+ *   put the whole value of a LOB column: CLOB as a text field in quotes,
+ *   BLOB in hexadecimal digits.
+ */
+static void olua_export_lob(
+    lua_State *lua ,
+    struct olua_export *ex ,
+    struct olua_connect *conn ,
+    OCILobLocator *locator ,
+    ub2 type )
+{
+    static const char hex[]="0123456789ABCDEF";
+    char chunk[8192];
+    oraub8 offset=1;
+    ub1 csfrm=SQLCS_IMPLICIT;
+    int quoted=( type == SQLT_CLOB && ! ex->tsv && ex->quote != '\0' );
+
+    if( type == SQLT_CLOB )
+        OCILobCharSetForm( olua_envhp(lua) , conn->errhp , locator , &csfrm );
+    if( quoted )
+        olua_export_putc(lua,ex,ex->quote);
+    for(;;){
+        oraub8 byte_amt=0 , char_amt=0;
+        sword status;
+        size_t i;
+
+        if( type == SQLT_CLOB )
+            char_amt = sizeof(chunk) / OLUA_LOB_MAXCHARSIZE;
+        else
+            byte_amt = sizeof(chunk) / 2;
+        status = OCILobRead2( conn->svchp , conn->errhp , locator ,
+                    &byte_amt , &char_amt , offset , chunk , sizeof(chunk) ,
+                    OCI_ONE_PIECE , NULL , NULL , 0 , csfrm );
+        if( status == OCI_NO_DATA || (status == OCI_SUCCESS && byte_amt == 0) )
+            break;
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+        if( type == SQLT_CLOB ){
+            olua_export_text(lua,ex,chunk,(size_t)byte_amt,quoted);
+            offset += char_amt;
+        }else{
+            for( i=0 ; i < (size_t)byte_amt ; i++ ){
+                olua_export_putc(lua,ex,hex[ ((ub1)chunk[i]) >> 4 ]);
+                olua_export_putc(lua,ex,hex[ ((ub1)chunk[i]) & 15 ]);
+            }
+            offset += byte_amt;
+        }
+    }
+    if( quoted )
+        olua_export_putc(lua,ex,ex->quote);
+}
+
+/* olua_format_int
+ *   write the decimal digits of `value` at the end of buf[] backward.
+ * return
+ *   the first character
+ */
+static char *olua_format_int(char *end,sb8 value)
+{
+    unsigned long long u=( value < 0 ? 0ULL-(unsigned long long)value : (unsigned long long)value );
+
+    do{
+        *--end = (char)('0' + u % 10);
+        u /= 10;
+    }while( u != 0 );
+    if( value < 0 )
+        *--end = '-';
+    return end;
+}
+
+/* olua_export_cell
+ *   put the column at the row `row` of the define arrays, and return
+ *   its bytes (0 for NULL) for the counter `bytes`.
+ */
+static ub4 olua_export_cell(
+    lua_State *lua ,
+    struct olua_export *ex ,
+    struct olua_statement *statement ,
+    struct olua_fetch_buffer *fetch_buffer ,
+    ub4 row )
+{
+    struct olua_datetime dt;
+    char buffer[LUAI_MAXNUMBER2STR+32];
+    char *value;
+    char *p;
+    size_t len;
+
+    if( fetch_buffer->ind[row] != 0 ){
+        olua_export_put(lua,ex,ex->null,ex->null_len);
+        return 0;
+    }
+    value = fetch_buffer->u.string + (size_t)fetch_buffer->size * row;
+
+    switch( fetch_buffer->type ){
+    case SQLT_STR:
+    case SQLT_CHR:
+    case SQLT_VCS:
+    case SQLT_AFC:
+        olua_export_field(lua,ex,value,fetch_buffer->len[row]);
+        break;
+    case SQLT_INT:
+        p = olua_format_int(buffer+sizeof(buffer),
+                fetch_buffer->size == sizeof(sb8) ? *(sb8*)value : *(int*)value);
+        olua_export_put(lua,ex,p,buffer+sizeof(buffer)-p);
+        break;
+    case SQLT_FLT:
+        len = sprintf(buffer,LUA_NUMBER_FMT,*(double*)value);
+        olua_export_put(lua,ex,buffer,len);
+        break;
+    case SQLT_DAT:
+        olua_decode_date((ub1*)value,&dt);
+        olua_export_put(lua,ex,buffer,olua_formatdatetime(buffer,&dt));
+        break;
+    case SQLT_TIMESTAMP:
+    case SQLT_TIMESTAMP_TZ:
+        olua_decode_timestamp(statement->envhp,statement->errhp,*(OCIDateTime**)value,
+            fetch_buffer->type == SQLT_TIMESTAMP_TZ ,&dt);
+        olua_export_put(lua,ex,buffer,olua_formatdatetime(buffer,&dt));
+        break;
+    case SQLT_CLOB:
+    case SQLT_BLOB:
+        olua_export_lob(lua,ex,statement->conn,*(OCILobLocator**)value,fetch_buffer->type);
+        break;
+    default:
+        olua_export_put(lua,ex,ex->null,ex->null_len);
+        break;
+    }
+    return fetch_buffer->len[row];
+}
+
+/** olua_export
+ *
+ * stack-in:
+ *   (+1) connection
+ *   (+2) sql string (SELECT)
+ *   (+3) bind values: {B1,B2...} or {V1=B1...} (optional)
+ *   (+4) { file=FILENAME or FILE-HANDLE , format="csv"|"tsv" ,
+ *          delimiter=CHAR , quote=CHAR , header=BOOL , null=STRING ,
+ *          fetch_size=N , prefetch_rows=N }
+ *        (optional: csv to io.stdout with header)
+ * stack-out
+ *   (+1) number of rows
+ *   (+2) number of bytes written
+ *
+ * Rows are formatted from the define arrays into the output buffer
+ * without making Lua values.
+ */
+static int olua_export(lua_State *lua)
+{
+    static const char *const formats[]={ "csv" , "tsv" , NULL };
+    struct olua_export *ex;
+    struct olua_statement *statement;
+    unsigned long long rows=0;
+    ub4 avail;
+    ub2 type=0;
+    int header , stmt , c;
+
+    luaL_checkstring(lua,2);
+    (void)olua_tohandle(lua,1,TNAME_CONNECTION);
+    if( ! lua_istable(lua,4) ){
+        lua_settop(lua,3);
+        lua_newtable(lua);
+    }
+    lua_settop(lua,4);
+
+    /* 5: state of export */
+    ex = lua_newuserdata(lua,sizeof(struct olua_export)+OLUA_EXPORT_BUFFER);
+    ex->fp = NULL;
+    ex->close = 0;
+    ex->len = 0;
+    ex->size = OLUA_EXPORT_BUFFER;
+    ex->bytes = 0;
+    if( luaL_newmetatable(lua,TNAME_EXPORT) ){
+        lua_pushcfunction(lua,olua_export_gc);
+        lua_setfield(lua,-2,"__gc");
+    }
+    lua_setmetatable(lua,-2);
+
+    /* 6: text of NULL */
+    lua_getfield(lua,4,"null");
+    if( lua_isstring(lua,6) ){
+        ex->null = lua_tolstring(lua,6,&ex->null_len);
+    }else{
+        lua_pushliteral(lua,"");
+        lua_replace(lua,6);
+        ex->null = "";
+        ex->null_len = 0;
+    }
+
+    lua_getfield(lua,4,"format");
+    ex->tsv = ( olua_checkenum(lua,-1,"format",formats,0) == 1 );
+    lua_getfield(lua,4,"delimiter");
+    ex->delimiter = lua_isstring(lua,-1) ? lua_tostring(lua,-1)[0] : ( ex->tsv ? '\t' : ',' );
+    lua_getfield(lua,4,"quote");
+    ex->quote = lua_isstring(lua,-1) ? lua_tostring(lua,-1)[0] : ( ex->tsv ? '\0' : '"' );
+    lua_getfield(lua,4,"header");
+    header = lua_isnil(lua,-1) || lua_toboolean(lua,-1);
+    lua_settop(lua,6);
+
+    lua_getfield(lua,4,"file");
+    if( lua_isnil(lua,-1) )
+        ex->fp = stdout;
+    else
+        ex->fp = olua_tofile(lua,-1,"wb",&ex->close,"export");
+    lua_pop(lua,1);
+
+    /* 7: statement-object */
+    olua_prepare(lua);
+    stmt = lua_gettop(lua);
+    statement = olua_tohandle(lua,stmt,TNAME_STATEMENT);
+    statement->sync = 1;
+    if( OCIAttrGet(statement->stmthp,OCI_HTYPE_STMT,(dvoid*)&type,NULL,
+            OCI_ATTR_STMT_TYPE,statement->errhp) != OCI_SUCCESS || type != OCI_STMT_SELECT )
+        return luaL_error(lua,"export: not a SELECT statement");
+    lua_getfield(lua,4,"fetch_size");
+    lua_setfield(lua,stmt,"fetch_size");
+    lua_getfield(lua,4,"prefetch_rows");
+    lua_setfield(lua,stmt,"prefetch_rows");
+    if( lua_istable(lua,3) ){
+        /* {B1,B2...} by position, or { NAME=VALUE } by name */
+        int n=(int)lua_rawlen(lua,3);
+
+        lua_pushvalue(lua,stmt);
+        if( n > 0 ){
+            luaL_checkstack(lua,n,"too many binds");
+            for( c=1 ; c <= n ; c++ )
+                lua_rawgeti(lua,3,c);
+        }else{
+            lua_pushvalue(lua,3);
+            n = 1;
+        }
+        olua_bind_core(lua,n);
+        lua_settop(lua,stmt);
+    }
+    olua_execute(lua);
+    lua_settop(lua,stmt);
+
+    if( header ){
+        for( c=0 ; c < statement->ncols ; c++ ){
+            if( c > 0 )
+                olua_export_putc(lua,ex,ex->delimiter);
+            olua_export_field(lua,ex,statement->fetch_buffer[c].name,
+                strlen(statement->fetch_buffer[c].name));
+        }
+        olua_export_putc(lua,ex,'\n');
+    }
+
+    while( (avail=olua_fetch_batch(lua,statement,NULL)) > 0 ){
+        unsigned long long bytes=0;
+        ub4 row;
+
+        for( row=statement->fetch_index ; row < statement->fetch_index+avail ; row++ ){
+            for( c=0 ; c < statement->ncols ; c++ ){
+                if( c > 0 )
+                    olua_export_putc(lua,ex,ex->delimiter);
+                bytes += olua_export_cell(lua,ex,statement,&statement->fetch_buffer[c],row);
+            }
+            olua_export_putc(lua,ex,'\n');
+        }
+        OLUA_COUNT(statement,bytes,bytes);
+        statement->fetch_index += avail;
+        rows += avail;
+    }
+    olua_export_flush(lua,ex);
+    olua_slowhook(lua,stmt,statement);
+    if( ex->close ){
+        if( fclose(ex->fp) != 0 ){
+            ex->fp = NULL;
+            return luaL_error(lua,"export: write error");
+        }
+    }else{
+        fflush(ex->fp);
+    }
+    ex->fp = NULL;
+    olua_statement_free(statement);
+
+    olua_pushint64(lua,(sb8)rows);
+    olua_pushint64(lua,(sb8)ex->bytes);
+    return 2;
+}
+
+/* A bind variable of array DML: one element for each row of a batch.
+ * The arrays live in a userdata on the Lua stack while the batch runs.
+ */
+struct olua_array_bind {
+    OCIBind *bind;
+    struct olua_outbind *out; /* RETURNING INTO the out-object instead */
+    ub2 type;
+    sb4 size;
+    ub4 rows;
+    char *data;
+    sb2 *ind;
+    ub2 *len;
+};
+
+/* the longest value of an array bind: its lengths are ub2 */
+#define OLUA_ARRAY_MAXLEN 0xFFFF
+
+static void olua_array_bind_alloc(lua_State *lua,struct olua_array_bind *ab,ub4 rows)
+{
+    size_t data_size = OLUA_ALIGN( (size_t)ab->size * rows );
+    char *p=lua_newuserdata(lua,data_size + rows * (sizeof(sb2)+sizeof(ub2)));
+
+    ab->data = p;
+    ab->ind  = (sb2*)( p + data_size );
+    ab->len  = (ub2*)( ab->ind + rows );
+    ab->rows = rows;
+}
+
+/* olua_array_bind_set
+ *   bind the arrays to the placeholder `name` (":NAME"), or to the
+ *   position `pos` when name is NULL.
+ */
+static void olua_array_bind_set(
+    lua_State *lua ,
+    struct olua_statement *statement ,
+    struct olua_array_bind *ab ,
+    ub4 pos ,
+    const char *name )
+{
+    sword status;
+
+    OLUA_COUNT(statement,binds,ab->rows);
+    ab->bind = NULL;
+    if( name != NULL ){
+        status = OCIBindByName( statement->stmthp , &ab->bind , statement->errhp ,
+                    (CONST text*)name , (sb4)strlen(name) ,
+                    (dvoid*)ab->data , ab->size , ab->type ,
+                    ab->ind , ab->len , NULL , 0 , NULL , OCI_DEFAULT );
+    }else{
+        status = OCIBindByPos( statement->stmthp , &ab->bind , statement->errhp ,
+                    pos ,
+                    (dvoid*)ab->data , ab->size , ab->type ,
+                    ab->ind , ab->len , NULL , 0 , NULL , OCI_DEFAULT );
+    }
+    if( status != OCI_SUCCESS )
+        checkerr(lua,statement->errhp,status);
+}
+
+/* olua_array_execute
+ *   execute the statement for `iters` rows of array binds with
+ *   OCI_BATCH_ERRORS. The message of each row which failed is stored
+ *   into the table at `errors` as errors[rowbase+offset+1].
+ * return
+ *   the number of rows processed successfully
+ */
+static ub4 olua_array_execute(
+    lua_State *lua ,
+    struct olua_connect *conn ,
+    struct olua_statement *statement ,
+    ub4 iters ,
+    ub4 rowbase ,
+    int errors )
+{
+    unsigned long long start;
+    sword status;
+    ub4 nerrors=0;
+    ub4 rowcount=0;
+    ub4 i;
+
+    errors = lua_absindex(lua,errors);
+    statement->executions++;
+    start = olua_now();
+    status = OCIStmtExecute(conn->svchp,statement->stmthp,statement->errhp,
+                iters,0,NULL,NULL,OCI_BATCH_ERRORS);
+    OLUA_COUNT_TIME(statement,execute_ns,start);
+    if( status != OCI_SUCCESS && status != OCI_SUCCESS_WITH_INFO ){
+        checkerr(lua,statement->errhp,status);
+        return 0;
+    }
+    OLUA_COUNT(statement,executes,1);
+
+    status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
+                (dvoid *)&nerrors, (ub4 *)0, (ub4)OCI_ATTR_NUM_DML_ERRORS, statement->errhp);
+    if( status == OCI_SUCCESS && nerrors > 0 ){
+        OCIError *rowerr=NULL;
+
+        OCIHandleAlloc(olua_envhp(lua), (dvoid**)&rowerr, OCI_HTYPE_ERROR, 0, NULL);
+        for( i=0 ; i < nerrors ; i++ ){
+            text errbuf[512];
+            sb4 errcode=0;
+            ub4 offset=0;
+            size_t len;
+
+            OCIParamGet(statement->errhp, OCI_HTYPE_ERROR, statement->errhp,
+                        (dvoid**)&rowerr, i);
+            OCIAttrGet(rowerr, OCI_HTYPE_ERROR, (dvoid*)&offset, (ub4*)0,
+                        OCI_ATTR_DML_ROW_OFFSET, statement->errhp);
+            errbuf[0] = '\0';
+            OCIErrorGet(rowerr, 1, (text*)NULL, &errcode,
+                        errbuf, (ub4)sizeof(errbuf), OCI_HTYPE_ERROR);
+            len = strlen((char*)errbuf);
+            while( len > 0 && (errbuf[len-1]=='\n' || errbuf[len-1]=='\r') )
+                --len;
+            lua_pushlstring(lua,(char*)errbuf,len);
+            lua_rawseti(lua,errors,rowbase+offset+1);
+        }
+        OCIHandleFree(rowerr, OCI_HTYPE_ERROR);
+    }
+
+    status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
+                (dvoid *)&rowcount, (ub4 *)0, (ub4)OCI_ATTR_ROW_COUNT, statement->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,statement->errhp,status);
+    statement->run_rows += rowcount;
+    olua_trace(statement,"execute",start,rowcount,NULL);
+    return rowcount;
+}
+
+/* olua_rows_push
+ *   push the value of the column keys[c] at the row `r` of the rows-table,
+ *   which is an array of rows or a table of column-arrays(columnar).
+ */
+static void olua_rows_push(lua_State *lua,int rows,int keys,int columnar,int r,int c)
+{
+    if( columnar ){
+        lua_rawgeti(lua,keys,c);
+        lua_gettable(lua,rows);
+        lua_rawgeti(lua,-1,r);
+    }else{
+        lua_rawgeti(lua,rows,r);
+        lua_rawgeti(lua,keys,c);
+        lua_gettable(lua,-2);
+    }
+    lua_remove(lua,-2);
+}
+
+/** olua_execmany
+ *
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) sql string
+ *   (+3) rows: array of row-tables or table of column-arrays
+ *   (+4) option table { batch=N , columnar=BOOLEAN } (optional)
+ *   An out-object in the first row (or as a column) receives the values
+ *   of RETURNING ... INTO of all the rows.
+ * stack-out
+ *   (+1) array of the number of rows processed by each batch
+ *   (+2) table of error messages indexed by the row number
+ */
+static int olua_execmany(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+    struct olua_statement *statement;
+    struct olua_array_bind *binds;
+    int columnar=0, named=0;
+    int ncols=0, nrows=0, nbatch=0;
+    int batch=OLUA_DEFAULT_BATCH;
+    int first, chunk, c, r;
+    int keys, names, counts, errors, stmt, outs;
+
+    luaL_checkstring(lua,2);
+    luaL_checktype(lua,3,LUA_TTABLE);
+    lua_settop(lua,4);
+    if( lua_istable(lua,4) ){
+        lua_getfield(lua,4,"batch");
+        if( lua_isnumber(lua,-1) )
+            batch = (int)lua_tointeger(lua,-1);
+        lua_getfield(lua,4,"columnar");
+        columnar = lua_toboolean(lua,-1);
+        lua_pop(lua,2);
+    }
+    if( batch < 1 )
+        batch = 1;
+
+    /* named columns: { NAME1={...} , NAME2={...} } */
+    if( ! columnar && lua_rawlen(lua,3) == 0 ){
+        lua_pushnil(lua);
+        if( lua_next(lua,3) ){
+            lua_pop(lua,2);
+            columnar = 1;
+        }
+    }
+
+    /* keys of bind-variables: positions or names of the first row */
+    lua_newtable(lua);
+    keys = lua_gettop(lua);
+    if( columnar )
+        lua_pushvalue(lua,3);
+    else
+        lua_rawgeti(lua,3,1);
+    if( lua_istable(lua,-1) ){
+        ncols = (int)lua_rawlen(lua,-1);
+        if( ncols > 0 ){
+            for( c=1 ; c <= ncols ; c++ ){
+                lua_pushinteger(lua,c);
+                lua_rawseti(lua,keys,c);
+            }
+        }else{
+            named = 1;
+            lua_pushnil(lua);
+            while( lua_next(lua,-2) ){
+                lua_pop(lua,1);
+                if( lua_type(lua,-1) == LUA_TSTRING ){
+                    lua_pushvalue(lua,-1);
+                    lua_rawseti(lua,keys,++ncols);
+                }
+            }
+        }
+    }
+    lua_pop(lua,1);
+
+    /* out-objects by the column number */
+    lua_newtable(lua);
+    outs = lua_gettop(lua);
+    for( c=1 ; c <= ncols ; c++ ){
+        lua_rawgeti(lua,keys,c);
+        if( columnar ){
+            lua_gettable(lua,3);
+        }else{
+            lua_rawgeti(lua,3,1);
+            lua_insert(lua,-2);
+            lua_gettable(lua,-2);
+            lua_remove(lua,-2);
+        }
+        if( olua_toout(lua,-1) != NULL ){
+            lua_rawseti(lua,outs,c);
+        }else{
+            if( columnar && nrows == 0 && lua_istable(lua,-1) )
+                nrows = (int)lua_rawlen(lua,-1);
+            lua_pop(lua,1);
+        }
+    }
+    if( ! columnar )
+        nrows = (int)lua_rawlen(lua,3);
+
+    /* placeholders ":NAME" */
+    lua_newtable(lua);
+    names = lua_gettop(lua);
+    for( c=1 ; named && c <= ncols ; c++ ){
+        lua_rawgeti(lua,keys,c);
+        lua_pushfstring(lua,":%s",lua_tostring(lua,-1));
+        lua_rawseti(lua,names,c);
+        lua_pop(lua,1);
+    }
+    lua_newtable(lua);
+    counts = lua_gettop(lua);
+    lua_newtable(lua);
+    errors = lua_gettop(lua);
+
+    if( nrows <= 0 || ncols <= 0 )
+        return 2;
+
+    lua_pushvalue(lua,1);
+    lua_pushvalue(lua,2);
+    olua_prepare(lua);
+    stmt = lua_gettop(lua);
+    lua_getfield(lua,-1,"handle");
+    statement = lua_touserdata(lua,-1);
+    lua_pop(lua,1);
+    olua_run_start(statement);
+
+    binds = lua_newuserdata(lua,sizeof(struct olua_array_bind)*ncols);
+
+    for( first=1 ; first <= nrows ; first += chunk ){
+        int top=lua_gettop(lua);
+
+        chunk = nrows - first + 1 ;
+        if( chunk > batch )
+            chunk = batch;
+
+        for( c=0 ; c < ncols ; c++ ){
+            struct olua_array_bind *ab=&binds[c];
+            size_t maxlen=0;
+            int numbers=0;
+            int fractions=0;
+
+            lua_rawgeti(lua,outs,c+1);
+            ab->out = olua_toout(lua,-1);
+            lua_pop(lua,1);
+            if( ab->out != NULL ){
+                ab->bind = NULL;
+                if( named ){
+                    lua_rawgeti(lua,names,c+1);
+                    olua_outbind_set(lua,statement,ab->out,&ab->bind,0,lua_tostring(lua,-1));
+                    lua_pop(lua,1);
+                }else{
+                    olua_outbind_set(lua,statement,ab->out,&ab->bind,c+1,NULL);
+                }
+                continue;
+            }
+
+            /* 1st pass: strings make the column VARCHAR2, or NUMBER as
+             * 64bit integer unless a number has a fraction. */
+            ab->type = SQLT_INT;
+            for( r=0 ; r < chunk ; r++ ){
+                olua_rows_push(lua,3,keys,columnar,first+r,c+1);
+                switch( lua_type(lua,-1) ){
+                case LUA_TSTRING:
+                    ab->type = SQLT_CHR;
+                    if( lua_rawlen(lua,-1) > OLUA_ARRAY_MAXLEN )
+                        return luaL_error(lua,"execmany: string longer than %d bytes at row %d column %d",
+                                    OLUA_ARRAY_MAXLEN,first+r,c+1);
+                    if( lua_rawlen(lua,-1) > maxlen )
+                        maxlen = lua_rawlen(lua,-1);
+                    break;
+                case LUA_TNUMBER:
+                    if( ! fractions ){
+                        sb8 dummy;
+                        fractions = ! olua_isinteger(lua,-1,&dummy);
+                    }
+                    numbers = 1;
+                    break;
+                case LUA_TNIL:
+                    break;
+                case LUA_TBOOLEAN:
+                    if( lua_toboolean(lua,-1) == 0 )
+                        break;
+                    /* fall through */
+                default:
+                    return luaL_error(lua,"execmany: unsupported %s value at row %d column %d",
+                                luaL_typename(lua,-1),first+r,c+1);
+                }
+                lua_pop(lua,1);
+            }
+            if( ab->type == SQLT_CHR ){
+                if( numbers && maxlen < LUAI_MAXNUMBER2STR )
+                    maxlen = LUAI_MAXNUMBER2STR;
+                ab->size = maxlen > 0 ? (sb4)maxlen : 1 ;
+            }else if( fractions ){
+                ab->type = SQLT_FLT;
+                ab->size = sizeof(double);
+            }else{
+                ab->size = sizeof(sb8);
+            }
+            olua_array_bind_alloc(lua,ab,chunk);
+
+            /* 2nd pass: fill arrays */
+            for( r=0 ; r < chunk ; r++ ){
+                char *value=ab->data + (size_t)ab->size * r;
+
+                olua_rows_push(lua,3,keys,columnar,first+r,c+1);
+                if( lua_toboolean(lua,-1) == 0 ){
+                    ab->ind[r] = OCI_IND_NULL;
+                    ab->len[r] = 0;
+                }else if( ab->type == SQLT_FLT ){
+                    *(double*)value = lua_tonumber(lua,-1);
+                    ab->ind[r] = 0;
+                    ab->len[r] = sizeof(double);
+                }else if( ab->type == SQLT_INT ){
+                    olua_isinteger(lua,-1,(sb8*)value);
+                    ab->ind[r] = 0;
+                    ab->len[r] = sizeof(sb8);
+                }else{
+                    size_t len;
+                    const char *s=lua_tolstring(lua,-1,&len);
+                    memcpy(value,s,len);
+                    ab->ind[r] = 0;
+                    ab->len[r] = (ub2)len;
+                }
+                lua_pop(lua,1);
+            }
+            if( named ){
+                lua_rawgeti(lua,names,c+1);
+                olua_array_bind_set(lua,statement,ab,0,lua_tostring(lua,-1));
+                lua_pop(lua,1);
+            }else{
+                olua_array_bind_set(lua,statement,ab,c+1,NULL);
+            }
+        }
+        lua_pushinteger(lua,
+            olua_array_execute(lua,conn,statement,chunk,first-1,errors));
+        lua_rawseti(lua,counts,++nbatch);
+        olua_outbind_collect(lua,conn,outs,first == 1);
+
+        lua_settop(lua,top);
+    }
+    olua_slowhook(lua,stmt,statement);
+    olua_statement_free(statement);
+
+    lua_pushvalue(lua,counts);
+    lua_pushvalue(lua,errors);
+    return 2;
+}
+
+/* A growing buffer of CONN:load. Not realloc, to be traced by MEMORY_TEST. */
+struct olua_strbuf {
+    char *p;
+    size_t len;
+    size_t size;
+};
+
+static void olua_strbuf_grow(lua_State *lua,struct olua_strbuf *sb,size_t need)
+{
+    size_t n=sb->size ? sb->size : 4096;
+    char *p;
+
+    while( n < need )
+        n *= 2;
+    if( (p = malloc(n)) == NULL ){
+        luaL_error(lua,"load: not enough memory");
+        return;
+    }
+    if( sb->p != NULL ){
+        memcpy(p,sb->p,sb->len);
+        free(sb->p);
+    }
+    sb->p = p;
+    sb->size = n;
+}
+
+#define olua_strbuf_putc(lua,sb,c) \
+    ( (sb)->len < (sb)->size ? (void)((sb)->p[(sb)->len++] = (char)(c)) \
+                             : (olua_strbuf_grow(lua,sb,(sb)->len+1),(void)((sb)->p[(sb)->len++] = (char)(c))) )
+
+/* State of CONN:load. The input buffer follows the structure in the
+ * same userdata, and the garbage collector closes the files on errors.
+ */
+struct olua_load {
+    FILE *fp;
+    int close;                /* fp was opened by load */
+    FILE *bad;                /* rejected records (NULL: discarded) */
+    int bad_close;
+    int tsv;                  /* backslash escapes instead of quoting */
+    char delimiter;
+    char quote;               /* '\0' never quoted */
+    const char *null;         /* text of NULL besides empty (may be NULL) */
+    size_t null_len;
+    int toolong;              /* the last record had a too long field */
+    unsigned long line;       /* line number of the next character */
+    unsigned long record_line;/* line number of the last record */
+    size_t record;            /* offset of the last record in raw */
+    struct olua_strbuf text;  /* fields of the batch */
+    struct olua_strbuf raw;   /* records of the batch as they were read */
+    size_t pos;
+    size_t end;
+    char buffer[1];
+};
+
+#define OLUA_LOAD_BUFFER 65536
+
+static int olua_load_gc(lua_State *lua)
+{
+    struct olua_load *ld=lua_touserdata(lua,1);
+
+    if( ld->fp != NULL && ld->close )
+        fclose(ld->fp);
+    ld->fp = NULL;
+    if( ld->bad != NULL && ld->bad_close )
+        fclose(ld->bad);
+    ld->bad = NULL;
+    if( ld->text.p != NULL )
+        free(ld->text.p);
+    ld->text.p = NULL;
+    if( ld->raw.p != NULL )
+        free(ld->raw.p);
+    ld->raw.p = NULL;
+    return 0;
+}
+
+/* olua_load_getc
+ *   read a character of the input and keep it in the raw record.
+ */
+static int olua_load_getc(lua_State *lua,struct olua_load *ld)
+{
+    int c;
+
+    if( ld->pos >= ld->end ){
+        ld->pos = 0;
+        ld->end = fread(ld->buffer,1,OLUA_LOAD_BUFFER,ld->fp);
+        if( ld->end == 0 ){
+            if( ferror(ld->fp) )
+                luaL_error(lua,"load: read error");
+            return EOF;
+        }
+    }
+    c = (unsigned char)ld->buffer[ld->pos++];
+    if( c == '\n' )
+        ld->line++;
+    olua_strbuf_putc(lua,&ld->raw,c);
+    return c;
+}
+
+/* olua_load_record
+ *   parse a record into the text of the batch. The fields up to `ncols`
+ *   are set to off[] and len[] (-1 for NULL) and the rest are dropped.
+ * return
+ *   the number of fields, or -1 at the end of input
+ */
+static int olua_load_record(
+    lua_State *lua ,
+    struct olua_load *ld ,
+    int ncols ,
+    size_t *off ,
+    sb4 *len )
+{
+    int nfields=0;
+    int c;
+
+    ld->toolong = 0;
+    do{
+        ld->record = ld->raw.len;
+        ld->record_line = ld->line;
+        c = olua_load_getc(lua,ld);
+    }while( c == '\n' );  /* empty lines */
+    if( c == EOF )
+        return -1;
+
+    for(;;){
+        size_t start=ld->text.len;
+        size_t n;
+        int quoted=0;
+        int cr=0;       /* the last character is a bare CR */
+
+        if( ld->quote != '\0' && c == ld->quote ){
+            quoted = 1;
+            for(;;){
+                if( (c = olua_load_getc(lua,ld)) == EOF )
+                    break;
+                if( c == ld->quote && (c = olua_load_getc(lua,ld)) != ld->quote )
+                    break;
+                olua_strbuf_putc(lua,&ld->text,c);
+            }
+        }
+        while( c != EOF && c != ld->delimiter && c != '\n' ){
+            cr = ( c == '\r' );
+            if( ld->tsv && c == '\\' ){
+                switch( c = olua_load_getc(lua,ld) ){
+                case 't': c = '\t'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case '\\': break;
+                case EOF:
+                    c = '\\';
+                    break;
+                default:
+                    olua_strbuf_putc(lua,&ld->text,'\\');
+                    if( c == ld->delimiter || c == '\n' )
+                        continue;
+                    break;
+                }
+            }
+            olua_strbuf_putc(lua,&ld->text,c);
+            c = olua_load_getc(lua,ld);
+        }
+        if( cr && c != ld->delimiter )
+            ld->text.len--;     /* CR of CRLF */
+
+        n = ld->text.len - start;
+        if( nfields < ncols ){
+            off[nfields] = start;
+            if( ! quoted && ( n == 0 ||
+                    ( ld->null != NULL && n == ld->null_len && memcmp(ld->text.p+start,ld->null,n) == 0 )) )
+                len[nfields] = -1;
+            else
+                len[nfields] = (sb4)n;
+            /* rejected: the array bind would truncate the length */
+            if( n > OLUA_ARRAY_MAXLEN )
+                ld->toolong = 1;
+        }else{
+            ld->text.len = start;
+        }
+        nfields++;
+        if( c != ld->delimiter )
+            return nfields;
+        c = olua_load_getc(lua,ld);
+    }
+}
+
+/* olua_load_reject
+ *   write the raw record `p` to the file of rejected records and
+ *   pop the message into the table at `errors` by the line number.
+ */
+static void olua_load_reject(
+    lua_State *lua ,
+    struct olua_load *ld ,
+    const char *p ,
+    size_t len ,
+    unsigned long line ,
+    int errors )
+{
+    if( ld->bad != NULL ){
+        if( fwrite(p,1,len,ld->bad) != len
+            || ( (len == 0 || p[len-1] != '\n') && putc('\n',ld->bad) == EOF ) )
+            luaL_error(lua,"load: write error");
+    }
+    lua_rawseti(lua,errors,(int)line);
+}
+
+/** olua_load
+ *
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) FILENAME or FILE-HANDLE
+ *   (+3) sql string (INSERT, UPDATE, MERGE or DELETE)
+ *   (+4) { format="csv"|"tsv" , delimiter=CHAR , quote=CHAR ,
+ *          header=BOOL , null=STRING , batch=N , commit_every=N ,
+ *          bad=FILENAME or FILE-HANDLE } (optional)
+ * stack-out
+ *   (+1) number of rows loaded
+ *   (+2) number of records rejected
+ *   (+3) table of error messages indexed by the line number
+ *
+ * The fields of each record are bound to the placeholders by position
+ * as VARCHAR2 arrays, and batches are executed as array DML.
+ */
+static int olua_load(lua_State *lua)
+{
+    static const char *const formats[]={ "csv" , "tsv" , NULL };
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+    struct olua_statement *statement;
+    struct olua_array_bind *binds;
+    struct olua_load *ld;
+    unsigned long long loaded=0, rejected=0, uncommitted=0;
+    unsigned long *lines;
+    size_t *raw_off, *raw_end, *off;
+    sb4 *len;
+    ub4 ncols=0;
+    int batch=OLUA_DEFAULT_BATCH;
+    int commit_every=0;
+    int header , errors , eof=0;
+    int c, r, n;
+    sword status;
+
+    luaL_checkstring(lua,3);
+    if( ! lua_istable(lua,4) ){
+        lua_settop(lua,3);
+        lua_newtable(lua);
+    }
+    lua_settop(lua,4);
+
+    /* 5: state of load */
+    ld = lua_newuserdata(lua,sizeof(struct olua_load)+OLUA_LOAD_BUFFER);
+    memset(ld,0,sizeof(struct olua_load));
+    ld->line = 1;
+    if( luaL_newmetatable(lua,TNAME_LOAD) ){
+        lua_pushcfunction(lua,olua_load_gc);
+        lua_setfield(lua,-2,"__gc");
+    }
+    lua_setmetatable(lua,-2);
+
+    /* 6: text of NULL */
+    lua_getfield(lua,4,"null");
+    if( lua_isstring(lua,6) )
+        ld->null = lua_tolstring(lua,6,&ld->null_len);
+
+    lua_getfield(lua,4,"format");
+    ld->tsv = ( olua_checkenum(lua,-1,"format",formats,0) == 1 );
+    lua_getfield(lua,4,"delimiter");
+    ld->delimiter = lua_isstring(lua,-1) ? lua_tostring(lua,-1)[0] : ( ld->tsv ? '\t' : ',' );
+    lua_getfield(lua,4,"quote");
+    ld->quote = lua_isstring(lua,-1) ? lua_tostring(lua,-1)[0] : ( ld->tsv ? '\0' : '"' );
+    lua_getfield(lua,4,"header");
+    header = lua_toboolean(lua,-1);
+    lua_getfield(lua,4,"batch");
+    if( lua_isnumber(lua,-1) )
+        batch = (int)lua_tointeger(lua,-1);
+    lua_getfield(lua,4,"commit_every");
+    if( lua_isnumber(lua,-1) )
+        commit_every = (int)lua_tointeger(lua,-1);
+    lua_settop(lua,6);
+    if( batch < 1 )
+        batch = 1;
+
+    ld->fp = olua_tofile(lua,2,"rb",&ld->close,"load");
+    lua_getfield(lua,4,"bad");
+    if( ! lua_isnil(lua,-1) )
+        ld->bad = olua_tofile(lua,-1,"wb",&ld->bad_close,"load");
+    lua_pop(lua,1);
+
+    /* 7: statement-object */
+    lua_pushvalue(lua,1);
+    lua_pushvalue(lua,3);
+    olua_prepare(lua);
+    statement = olua_tohandle(lua,7,TNAME_STATEMENT);
+    olua_run_start(statement);
+    status = OCIAttrGet(statement->stmthp,OCI_HTYPE_STMT,(dvoid*)&ncols,NULL,
+                OCI_ATTR_BIND_COUNT,statement->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,statement->errhp,status);
+    if( ncols == 0 )
+        return luaL_error(lua,"load: no placeholders in the statement");
+    luaL_checkstack(lua,(int)ncols+8,"load: too many placeholders");
+
+    /* 8: bind-arrays, 9: fields, 10: records, 11: errors */
+    binds = lua_newuserdata(lua,sizeof(struct olua_array_bind)*ncols);
+    off = lua_newuserdata(lua,(sizeof(size_t)+sizeof(sb4))*ncols*batch);
+    len = (sb4*)( off + (size_t)ncols*batch );
+    raw_off = lua_newuserdata(lua,(sizeof(size_t)*2+sizeof(unsigned long))*batch);
+    raw_end = raw_off + batch;
+    lines = (unsigned long*)( raw_end + batch );
+    lua_newtable(lua);
+    errors = lua_gettop(lua);
+
+    if( header && olua_load_record(lua,ld,(int)ncols,off,len) < 0 )
+        eof = 1;
+
+    while( ! eof ){
+        int rows=0;
+        ub4 count;
+
+        ld->text.len = 0;
+        ld->raw.len = 0;
+        while( rows < batch ){
+            size_t text_len=ld->text.len;
+            size_t *o=off + (size_t)ncols*rows;
+            sb4 *l=len + (size_t)ncols*rows;
+
+            if( (n = olua_load_record(lua,ld,(int)ncols,o,l)) < 0 ){
+                eof = 1;
+                break;
+            }
+            if( n != (int)ncols || ld->toolong ){
+                if( ld->toolong )
+                    lua_pushliteral(lua,"load: too long field");
+                else
+                    lua_pushfstring(lua,"load: %d fields (expected %d)",n,(int)ncols);
+                olua_load_reject(lua,ld,ld->raw.p+ld->record,ld->raw.len-ld->record,
+                    ld->record_line,errors);
+                rejected++;
+                ld->text.len = text_len;
+                ld->raw.len = ld->record;
+                continue;
+            }
+            raw_off[rows] = ld->record;
+            raw_end[rows] = ld->raw.len;
+            lines[rows] = ld->record_line;
+            rows++;
+        }
+        if( rows == 0 )
+            break;
+
+        /* column-major arrays of VARCHAR2 as wide as the longest field */
+        for( c=0 ; c < (int)ncols ; c++ ){
+            struct olua_array_bind *ab=&binds[c];
+            sb4 maxlen=1;
+
+            for( r=0 ; r < rows ; r++ ){
+                if( len[(size_t)ncols*r+c] > maxlen )
+                    maxlen = len[(size_t)ncols*r+c];
+            }
+            ab->type = SQLT_CHR;
+            ab->size = maxlen;
+            olua_array_bind_alloc(lua,ab,rows);
+            for( r=0 ; r < rows ; r++ ){
+                size_t i=(size_t)ncols*r+c;
+
+                if( len[i] < 0 ){
+                    ab->ind[r] = OCI_IND_NULL;
+                    ab->len[r] = 0;
+                }else{
+                    memcpy(ab->data + (size_t)ab->size * r , ld->text.p + off[i] , len[i]);
+                    ab->ind[r] = 0;
+                    ab->len[r] = (ub2)len[i];  /* <= OLUA_ARRAY_MAXLEN */
+                }
+            }
+            olua_array_bind_set(lua,statement,ab,c+1,NULL);
+        }
+
+        /* 12: errors of this batch */
+        lua_newtable(lua);
+        count = olua_array_execute(lua,conn,statement,rows,0,-1);
+        for( r=0 ; r < rows ; r++ ){
+            lua_rawgeti(lua,-1,r+1);
+            if( lua_isnil(lua,-1) ){
+                lua_pop(lua,1);
+                continue;
+            }
+            olua_load_reject(lua,ld,ld->raw.p+raw_off[r],raw_end[r]-raw_off[r],lines[r],errors);
+            rejected++;
+        }
+        lua_settop(lua,errors);
+
+        loaded += count;
+        uncommitted += count;
+        if( commit_every > 0 && uncommitted >= (unsigned long long)commit_every ){
+            status = OCITransCommit(conn->svchp, conn->errhp, OCI_DEFAULT);
+            if( status != OCI_SUCCESS )
+                checkerr(lua,conn->errhp,status);
+            uncommitted = 0;
+        }
+    }
+    if( commit_every > 0 && uncommitted > 0 ){
+        status = OCITransCommit(conn->svchp, conn->errhp, OCI_DEFAULT);
+        if( status != OCI_SUCCESS )
+            checkerr(lua,conn->errhp,status);
+    }
+    olua_slowhook(lua,7,statement);
+    olua_statement_free(statement);
+
+    if( ld->bad != NULL ){
+        if( (ld->bad_close ? fclose(ld->bad) : fflush(ld->bad)) != 0 ){
+            ld->bad = NULL;
+            return luaL_error(lua,"load: write error");
+        }
+        ld->bad = NULL;
+    }
+    if( ld->close )
+        fclose(ld->fp);
+    ld->fp = NULL;
+
+    olua_pushint64(lua,(sb8)loaded);
+    olua_pushint64(lua,(sb8)rejected);
+    lua_pushvalue(lua,errors);
+    return 3;
+}
+
+/* A direct path load into a table: the column array is filled from Lua
+ * values, converted to a stream and loaded without SQL.
+ */
+struct olua_dirpath {
+    OCIDirPathCtx *dpctx;
+    OCIDirPathColArray *dpca;
+    OCIDirPathStream *dpstr;
+    OCIError *errhp;
+    struct olua_connect *conn;
+    ub4 ncols;
+    ub4 maxrows;                /* rows of the column array */
+    int active;                 /* prepared and neither finished nor aborted */
+    unsigned long long rows;
+};
+
+#define OLUA_DIRPATH_SIZE 4000
+
+/* olua_dirpath_free
+ *   abort the load if it is active and free the handles.
+ */
+static void olua_dirpath_free(struct olua_dirpath *dp)
+{
+    if( dp->active && dp->dpctx != NULL )
+        OCIDirPathAbort(dp->dpctx,dp->errhp);
+    dp->active = 0;
+    if( dp->dpstr != NULL ){
+        OCIHandleFree(dp->dpstr,OCI_HTYPE_DIRPATH_STREAM);
+        dp->dpstr = NULL;
+    }
+    if( dp->dpca != NULL ){
+        OCIHandleFree(dp->dpca,OCI_HTYPE_DIRPATH_COLUMN_ARRAY);
+        dp->dpca = NULL;
+    }
+    if( dp->dpctx != NULL ){
+        OCIHandleFree(dp->dpctx,OCI_HTYPE_DIRPATH_CTX);
+        dp->dpctx = NULL;
+    }
+    if( dp->errhp != NULL ){
+        OCIHandleFree(dp->errhp,OCI_HTYPE_ERROR);
+        dp->errhp = NULL;
+    }
+}
+
+static int olua_dirpath_gc(lua_State *lua)
+{
+    olua_dirpath_free( lua_touserdata(lua,1) );
+    return 0;
+}
+
+static struct olua_dirpath *olua_dirpath_check(lua_State *lua)
+{
+    struct olua_dirpath *dp=olua_tohandle(lua,1,TNAME_DIRPATH);
+
+    luaL_argcheck(lua,dp->active,1,"direct path load has been finished.");
+    return dp;
+}
+
+/* olua_dirpath_load
+ *   convert `rows` rows of the column array to streams and load them.
+ */
+static void olua_dirpath_load(lua_State *lua,struct olua_dirpath *dp,ub4 rows)
+{
+    ub4 rowoff=0;
+
+    for(;;){
+        sword status , status2;
+        ub4 converted=0;
+
+        status = OCIDirPathColArrayToStream(dp->dpca,dp->dpctx,dp->dpstr,dp->errhp,
+                    rows,rowoff);
+        if( status != OCI_SUCCESS && status != OCI_CONTINUE )
+            checkerr(lua,dp->errhp,status);
+        status2 = OCIDirPathLoadStream(dp->dpctx,dp->dpstr,dp->errhp);
+        if( status2 != OCI_SUCCESS )
+            checkerr(lua,dp->errhp,status2);
+        OCIDirPathStreamReset(dp->dpstr,dp->errhp);
+        if( status == OCI_SUCCESS )
+            break;
+
+        /* the stream is full: go on from the next row not converted */
+        OCIAttrGet(dp->dpca,OCI_HTYPE_DIRPATH_COLUMN_ARRAY,(dvoid*)&converted,NULL,
+            OCI_ATTR_ROW_COUNT,dp->errhp);
+        rowoff += converted;
+    }
+}
+
+/** olua_dirpath_append
+ *
+ * stack-in:
+ *   (+1) direct-path-object
+ *   (+2) rows: array of row-tables or table of column-arrays
+ *   (+3) option table { columnar=BOOLEAN } (optional)
+ * stack-out
+ *   (+1) number of rows appended
+ *
+ * The column array is filled column by column. A row-table has the values
+ * in the order of the columns; a table of column-arrays is keyed by the
+ * column names, or by the positions with columnar=true.
+ */
+static int olua_dirpath_append(lua_State *lua)
+{
+    struct olua_dirpath *dp=olua_dirpath_check(lua);
+    char *numbers;
+    int columnar=0, named=0;
+    int nrows, first, chunk, r;
+    ub4 c;
+
+    luaL_checktype(lua,2,LUA_TTABLE);
+    lua_settop(lua,3);
+    if( lua_istable(lua,3) ){
+        lua_getfield(lua,3,"columnar");
+        columnar = lua_toboolean(lua,-1);
+        lua_pop(lua,1);
+    }
+    if( ! columnar && lua_rawlen(lua,2) == 0 ){
+        lua_pushnil(lua);
+        if( lua_next(lua,2) ){
+            lua_pop(lua,2);
+            columnar = named = 1;
+        }
+    }
+    /* 4: column names */
+    lua_getfield(lua,1,"columns");
+
+    if( columnar ){
+        if( named ){
+            lua_rawgeti(lua,4,1);
+            lua_gettable(lua,2);
+        }else{
+            lua_rawgeti(lua,2,1);
+        }
+        nrows = lua_istable(lua,-1) ? (int)lua_rawlen(lua,-1) : 0;
+        lua_pop(lua,1);
+    }else{
+        nrows = (int)lua_rawlen(lua,2);
+    }
+    if( nrows <= 0 ){
+        lua_pushinteger(lua,0);
+        return 1;
+    }
+
+    /* 5: texts of numbers, which have to live until the load */
+    numbers = lua_newuserdata(lua,(size_t)dp->maxrows * dp->ncols * LUAI_MAXNUMBER2STR);
+
+    for( first=0 ; first < nrows ; first += chunk ){
+        chunk = nrows - first;
+        if( chunk > (int)dp->maxrows )
+            chunk = (int)dp->maxrows;
+
+        OCIDirPathColArrayReset(dp->dpca,dp->errhp);
+        for( c=0 ; c < dp->ncols ; c++ ){
+            if( columnar ){
+                if( named ){
+                    lua_rawgeti(lua,4,c+1);
+                    lua_gettable(lua,2);
+                }else{
+                    lua_rawgeti(lua,2,c+1);
+                }
+                if( ! lua_istable(lua,-1) )
+                    return luaL_error(lua,"directpath: column %d is not an array",(int)c+1);
+            }
+            for( r=0 ; r < chunk ; r++ ){
+                char *num=numbers + ((size_t)r * dp->ncols + c) * LUAI_MAXNUMBER2STR;
+                const char *value=NULL;
+                size_t len=0;
+                ub1 flag=OCI_DIRPATH_COL_COMPLETE;
+                sb8 n;
+
+                if( columnar ){
+                    lua_rawgeti(lua,-1,first+r+1);
+                }else{
+                    lua_rawgeti(lua,2,first+r+1);
+                    if( ! lua_istable(lua,-1) )
+                        return luaL_error(lua,"directpath: row %d is not a table",first+r+1);
+                    lua_rawgeti(lua,-1,c+1);
+                    lua_remove(lua,-2);
+                }
+                switch( lua_type(lua,-1) ){
+                case LUA_TSTRING:
+                    /* the string is kept by the rows-table */
+                    value = lua_tolstring(lua,-1,&len);
+                    break;
+                case LUA_TNUMBER:
+                    if( olua_isinteger(lua,-1,&n) ){
+                        char *end=num + LUAI_MAXNUMBER2STR;
+
+                        value = olua_format_int(end,n);
+                        len = end - value;
+                    }else{
+                        len = snprintf(num,LUAI_MAXNUMBER2STR,LUA_NUMBER_FMT,lua_tonumber(lua,-1));
+                        value = num;
+                    }
+                    break;
+                case LUA_TNIL:
+                    flag = OCI_DIRPATH_COL_NULL;
+                    break;
+                case LUA_TBOOLEAN:
+                    if( lua_toboolean(lua,-1) == 0 ){
+                        flag = OCI_DIRPATH_COL_NULL;
+                        break;
+                    }
+                    /* fall through */
+                default:
+                    return luaL_error(lua,"directpath: unsupported %s value at row %d column %d",
+                                luaL_typename(lua,-1),first+r+1,(int)c+1);
+                }
+                lua_pop(lua,1);
+                OCIDirPathColArrayEntrySet(dp->dpca,dp->errhp,(ub4)r,(ub2)c,
+                    (ub1*)value,(ub4)len,flag);
+            }
+            if( columnar )
+                lua_pop(lua,1);
+        }
+        olua_dirpath_load(lua,dp,(ub4)chunk);
+        dp->rows += chunk;
+    }
+    lua_pushinteger(lua,nrows);
+    return 1;
+}
+
+/** olua_dirpath_finish
+ *
+ * stack-in:
+ *   (+1) direct-path-object
+ * stack-out
+ *   (+1) number of rows appended
+ *
+ * The rows are committed by OCIDirPathFinish.
+ */
+static int olua_dirpath_finish(lua_State *lua)
+{
+    struct olua_dirpath *dp=olua_dirpath_check(lua);
+    sword status;
+
+    status = OCIDirPathFinish(dp->dpctx,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+    dp->active = 0;
+    olua_pushint64(lua,(sb8)dp->rows);
+    olua_dirpath_free(dp);
+    return 1;
+}
+
+/* lua-function: olua_dirpath_abort
+ *  stack-in
+ *    (+1) direct-path-object
+ */
+static int olua_dirpath_abort(lua_State *lua)
+{
+    olua_dirpath_free( olua_tohandle(lua,1,TNAME_DIRPATH) );
+    return 0;
+}
+
+/* olua_dirpath_setattr
+ *   set the string at `index` to the attribute of the handle.
+ */
+static void olua_dirpath_setattr(
+    lua_State *lua ,
+    struct olua_dirpath *dp ,
+    dvoid *handle ,
+    ub4 type ,
+    int index ,
+    ub4 attr )
 {
-    int i;
-    struct olua_statement *statement=olua_tohandle(lua,-nbinds-1,TNAME_STATEMENT);
+    size_t len;
+    const char *s=lua_tolstring(lua,index,&len);
     sword status;
 
-    for(i=0;i<nbinds;i++){
-        int sp=-nbinds+i;
-        struct olua_bind_buffer *b;
+    status = OCIAttrSet(handle,type,(dvoid*)s,(ub4)len,attr,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+}
 
-        DEBUG( printf("try bind %d\n",i+1));
-        DEBUG( printf("Statement-handle=%p\n",statement->stmthp) );
+/** olua_directpath
+ *
+ * stack-in:
+ *   (+1) connection.
+ *   (+2) table name ("TABLE" or "SCHEMA.TABLE")
+ *   (+3) columns: { NAME1 , { NAME2 , size=N , date_format=FORMAT } ... }
+ *   (+4) { schema=NAME , batch=N , buffer_size=N , date_format=FORMAT ,
+ *          nologging=BOOL , parallel=BOOL } (optional)
+ * stack-out
+ *   (+1) direct-path-object
+ *
+ * All columns are given as text, and the server converts them.
+ */
+static int olua_directpath(lua_State *lua)
+{
+    struct olua_connect *conn=olua_tohandle(lua,1,TNAME_CONNECTION);
+    OCIEnv *envhp=olua_envhp(lua);
+    struct olua_dirpath *dp;
+    OCIParam *collist=NULL;
+    const char *table=luaL_checkstring(lua,2);
+    const char *dot;
+    sword status;
+    ub4 value, c;
+    ub1 flag;
 
+    luaL_argcheck(lua,conn->svchp != NULL,1,"connection has beed closed.");
+    luaL_checktype(lua,3,LUA_TTABLE);
+    if( ! lua_istable(lua,4) ){
+        lua_settop(lua,3);
+        lua_newtable(lua);
+    }
+    lua_settop(lua,4);
 
-        if( lua_istable(lua,sp) ){
-            lua_pushnil(lua);
-            while( lua_next(lua,sp-1) ){
-                const char *key; size_t key_len; char *key2;
+    /* 5: object */
+    lua_newtable(lua);
+    dp = lua_newuserdata(lua,sizeof(struct olua_dirpath));
+    memset(dp,0,sizeof(struct olua_dirpath));
+    dp->conn = conn;
+    if( luaL_newmetatable(lua,TNAME_DIRPATH) ){
+        lua_pushcfunction(lua,olua_dirpath_gc);
+        lua_setfield(lua,-2,"__gc");
 
-                lua_pushvalue(lua,-2);
-                key = lua_tolstring(lua,-1,&key_len);
+        lua_pushstring(lua,TNAME_DIRPATH);
+        lua_setfield(lua,-2,"__metatable");
+    }
+    lua_setmetatable(lua,-2);
+    lua_setfield(lua,5,"handle");
 
-                if( key[0] == ':' ){
-                    key2 = strdup(key);
-                }else{
-                    key2 = malloc(++key_len+2);
-                    key2[0] = ':';
-                    strcpy(key2+1,key);
-                }
+    OCIHandleAlloc(envhp,(dvoid**)&dp->errhp,OCI_HTYPE_ERROR,0,NULL);
+    status = OCIHandleAlloc(envhp,(dvoid**)&dp->dpctx,OCI_HTYPE_DIRPATH_CTX,0,NULL);
+    if( status != OCI_SUCCESS )
+        return luaL_error(lua,"directpath: can not allocate the context");
 
-                if( lua_toboolean(lua,-2) == 0 ){
-                    b=olua_bind_buffer_new(0);
-                    b->name.s = key2;
-                    b->u.buffer[0] = '\0';
-                    b->indicator = OCI_IND_NULL ;
-
-                    DEBUG( printf("BIND: %s=>NULL\n" , key2) );
-
-                    status = OCIBindByName( 
-                                statement->stmthp ,
-                                &b->bind ,
-                                statement->errhp ,
-                                b->name.u ,
-                                key_len ,
-                                (dvoid *)b->u.buffer , /* valuep */
-                                1 , /* value_sz */
-                                SQLT_STR , /* dty */ 
-                                &b->indicator ,
-                                NULL ,
-                                NULL ,
-                                0 ,
-                                NULL ,
-                                OCI_DEFAULT );
-
-
-                }else if( lua_isnumber(lua,-2) ){
-                    b=olua_bind_buffer_new(0);
-                    b->name.s = key2;
-                    b->u.number = lua_tonumber(lua,-2);
-
-                    DEBUG( printf("BIND: %s[len=%d]=>%d(number)\n" ,
-                                    key2,key_len,b->u.number) );
-
-                    status = OCIBindByName( 
-                                statement->stmthp ,
-                                &b->bind ,
-                                statement->errhp ,
-                                b->name.u ,
-                                -1 ,
-                                (dvoid *)&b->u.number , /* valuep */
-                                (sword)sizeof(sword) , /* value_sz */
-                                SQLT_INT , /* dty */ 
-                                &b->indicator ,
-                                NULL ,
-                                NULL ,
-                                0 ,
-                                NULL ,
-                                OCI_DEFAULT );
-                }else{
-                    size_t val_len; 
-
-                    b=olua_bind_buffer_new(val_len + 1);
-                    b->name.s = key2;
-                    strcpy( b->u.buffer , lua_tolstring(lua,-2,&val_len) );
-
-                    DEBUG( printf("BIND: %s=>%s(string)\n" , key2,b->u.buffer) );
-
-                    status = OCIBindByName( 
-                                statement->stmthp ,
-                                &b->bind ,
-                                statement->errhp ,
-                                b->name.u ,
-                                key_len ,
-                                b->u.buffer ,
-                                val_len+1 ,
-                                SQLT_STR , 
-                                &b->indicator ,
-                                NULL ,
-                                NULL ,
-                                0 ,
-                                NULL ,
-                                OCI_DEFAULT );
-                }
-                if( status != OCI_SUCCESS ){
-                    free( b );
-                    checkerr(lua,statement->errhp,status);
-                    abort();
-                }
-                b->next = statement->bind_buffer ;
-                statement->bind_buffer = b;
+    /* 6: table name, 7: schema name */
+    dot = strchr(table,'.');
+    if( dot != NULL ){
+        lua_pushstring(lua,dot+1);
+        lua_pushlstring(lua,table,dot-table);
+    }else{
+        lua_pushvalue(lua,2);
+        lua_getfield(lua,4,"schema");
+    }
+    olua_dirpath_setattr(lua,dp,dp->dpctx,OCI_HTYPE_DIRPATH_CTX,6,OCI_ATTR_NAME);
+    if( lua_isstring(lua,7) )
+        olua_dirpath_setattr(lua,dp,dp->dpctx,OCI_HTYPE_DIRPATH_CTX,7,OCI_ATTR_SCHEMA_NAME);
+    lua_settop(lua,5);
+
+    lua_getfield(lua,4,"date_format");
+    if( lua_isstring(lua,-1) )
+        olua_dirpath_setattr(lua,dp,dp->dpctx,OCI_HTYPE_DIRPATH_CTX,-1,OCI_ATTR_DATEFORMAT);
+    lua_getfield(lua,4,"buffer_size");
+    if( lua_isnumber(lua,-1) ){
+        value = (ub4)lua_tointeger(lua,-1);
+        OCIAttrSet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,&value,0,OCI_ATTR_BUF_SIZE,dp->errhp);
+    }
+    lua_getfield(lua,4,"batch");
+    if( lua_isnumber(lua,-1) ){
+        value = (ub4)lua_tointeger(lua,-1);
+        OCIAttrSet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,&value,0,OCI_ATTR_NUM_ROWS,dp->errhp);
+    }
+    lua_getfield(lua,4,"nologging");
+    if( lua_toboolean(lua,-1) ){
+        flag = 1;
+        OCIAttrSet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,&flag,0,OCI_ATTR_DIRPATH_NOLOG,dp->errhp);
+    }
+    lua_getfield(lua,4,"parallel");
+    if( lua_toboolean(lua,-1) ){
+        flag = 1;
+        OCIAttrSet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,&flag,0,OCI_ATTR_DIRPATH_PARALLEL,dp->errhp);
+    }
+    lua_settop(lua,5);
 
-                lua_pop(lua,2); /* drop value and key duplicated */
-            }
-            continue;
-        }else if( lua_toboolean(lua,sp)==0 ){ /* nil or false => NULL */
-            b=olua_bind_buffer_new(0);
-            b->indicator = OCI_IND_NULL ;
-            status = OCIBindByPos( statement->stmthp , 
-                          &b->bind ,
-                          statement->errhp ,
-                          i+1 , 
-                          (dvoid*)b->u.buffer , /* valuep */
-                          1 , /* value_sz */
-                          SQLT_STR , /* dty */
-                          &b->indicator ,
-                          NULL ,
-                          NULL ,
-                          0 ,
-                          NULL ,
-                          OCI_DEFAULT 
-                    );
-
-        }else if( lua_isnumber(lua,sp) ){
-            b=olua_bind_buffer_new(0);
-            assert( b != NULL );
-
-            b->u.number = lua_tointeger(lua,sp);
-
-            DEBUG( printf("find %d(as number)\n",b->u.number) );
-
-            status = OCIBindByPos( statement->stmthp , 
-                        &b->bind ,
-                        statement->errhp ,
-                        i+1 , /* position */
-                        (dvoid *)&b->u.number , /* valuep */
-                        (sword)sizeof(sword) ,  /* value_sz */
-                        SQLT_INT , /* dty */
-                        &b->indicator ,
-                        (ub2*)NULL ,
-                        (ub2*)NULL , 
-                        (ub4)0 ,  /* maxarr_len */
-                        (ub4*)NULL , /* curelep */
-                        OCI_DEFAULT /* mode */
-                    ); 
+    /* 6: column names */
+    dp->ncols = (ub4)lua_rawlen(lua,3);
+    luaL_argcheck(lua,dp->ncols > 0,3,"no columns");
+    value = dp->ncols;
+    status = OCIAttrSet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,&value,0,OCI_ATTR_NUM_COLS,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+    status = OCIAttrGet(dp->dpctx,OCI_HTYPE_DIRPATH_CTX,(dvoid*)&collist,NULL,
+                OCI_ATTR_LIST_COLUMNS,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+
+    lua_createtable(lua,(int)dp->ncols,0);
+    for( c=0 ; c < dp->ncols ; c++ ){
+        OCIParam *column=NULL;
+        ub2 type=SQLT_CHR;
+        ub4 size=OLUA_DIRPATH_SIZE;
+
+        /* 7: name, 8: date_format */
+        lua_rawgeti(lua,3,c+1);
+        if( lua_istable(lua,-1) ){
+            lua_getfield(lua,-1,"size");
+            if( lua_isnumber(lua,-1) )
+                size = (ub4)lua_tointeger(lua,-1);
+            lua_pop(lua,1);
+            lua_getfield(lua,-1,"date_format");
+            lua_rawgeti(lua,-2,1);
+            lua_replace(lua,7);
         }else{
-            const char *string=lua_tostring(lua,sp);
-            size_t len;
-            
-            assert( string != NULL );
-            len=strlen(string);
-
-            b=olua_bind_buffer_new(len);
-            assert( b != NULL );
-            strcpy( b->u.buffer , string );
-
-            DEBUG( printf("find '%s' (as string)\n",string) );
-            status = OCIBindByPos( statement->stmthp , 
-                          &b->bind ,
-                          statement->errhp ,
-                          i+1 , 
-                          (dvoid*)b->u.buffer , /* valuep */
-                          len+1 , /* value_sz */
-                          SQLT_STR , /* dty */
-                          &b->indicator ,
-                          NULL ,
-                          NULL ,
-                          0 ,
-                          NULL ,
-                          OCI_DEFAULT 
-                    );
-        }
-        if( status != OCI_SUCCESS ){
-            free( b );
-            checkerr(lua,statement->errhp,status);
-            abort();
+            lua_pushnil(lua);
         }
-        b->next = statement->bind_buffer ;
-        statement->bind_buffer = b;
+        if( ! lua_isstring(lua,7) )
+            return luaL_error(lua,"directpath: no name of column %d",(int)c+1);
+
+        status = OCIParamGet(collist,OCI_DTYPE_PARAM,dp->errhp,(dvoid**)&column,c+1);
+        if( status != OCI_SUCCESS )
+            checkerr(lua,dp->errhp,status);
+        olua_dirpath_setattr(lua,dp,column,OCI_DTYPE_PARAM,7,OCI_ATTR_NAME);
+        OCIAttrSet(column,OCI_DTYPE_PARAM,&type,0,OCI_ATTR_DATA_TYPE,dp->errhp);
+        OCIAttrSet(column,OCI_DTYPE_PARAM,&size,0,OCI_ATTR_DATA_SIZE,dp->errhp);
+        if( lua_isstring(lua,8) )
+            olua_dirpath_setattr(lua,dp,column,OCI_DTYPE_PARAM,8,OCI_ATTR_DATEFORMAT);
+        OCIDescriptorFree(column,OCI_DTYPE_PARAM);
+
+        lua_pushvalue(lua,7);
+        lua_rawseti(lua,6,c+1);
+        lua_settop(lua,6);
     }
-    lua_pushboolean(lua,1);
-    DEBUG( printf("LEAVE: olua_bind(successfully)\n") );
+    lua_setfield(lua,5,"columns");
+
+    status = OCIDirPathPrepare(dp->dpctx,conn->svchp,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+    dp->active = 1;
+
+    if( OCIHandleAlloc(dp->dpctx,(dvoid**)&dp->dpca,OCI_HTYPE_DIRPATH_COLUMN_ARRAY,0,NULL) != OCI_SUCCESS
+     || OCIHandleAlloc(dp->dpctx,(dvoid**)&dp->dpstr,OCI_HTYPE_DIRPATH_STREAM,0,NULL) != OCI_SUCCESS )
+        return luaL_error(lua,"directpath: can not allocate the column array");
+    status = OCIAttrGet(dp->dpca,OCI_HTYPE_DIRPATH_COLUMN_ARRAY,(dvoid*)&dp->maxrows,NULL,
+                OCI_ATTR_NUM_ROWS,dp->errhp);
+    if( status != OCI_SUCCESS )
+        checkerr(lua,dp->errhp,status);
+    if( dp->maxrows == 0 )
+        dp->maxrows = 1;
+
+    /* method: append */
+    lua_pushcfunction(lua,olua_dirpath_append);
+    lua_setfield(lua,5,"append");
+
+    /* method: finish */
+    lua_pushcfunction(lua,olua_dirpath_finish);
+    lua_setfield(lua,5,"finish");
+
+    /* method: abort */
+    lua_pushcfunction(lua,olua_dirpath_abort);
+    lua_setfield(lua,5,"abort");
+
+    /* member: connection */
+    lua_pushvalue(lua,1);
+    lua_setfield(lua,5,"connection");
+
     return 1;
 }
 
-/** olua_bind
- *
- * stack-in:
- *  +1   = statement-object(table)
- *  +2.. = bind-variables
- * stack-out:
- *  +3   = true:succcess , nil:failure
+struct olua_pool {
+    OCISPool *spoolhp;
+    OCIError *errhp;
+    OraText *name;
+    ub4 name_len;
+    ub4 max;                    /* maximum number of sessions */
+    unsigned long gets;         /* number of OCISessionGet */
+    unsigned long long wait_ns; /* total time spent in OCISessionGet */
+};
+
+/* lua-function: olua_pool_close
+ *  stack-in
+ *    (+1) pool-object
+ *  The pool is not closed while sessions are acquired: they would be
+ *  released into the pool destroyed. (The connections keep the pool
+ *  alive, so the garbage collector never meets them.)
  */
-static int olua_bind( lua_State *lua )
+static int olua_pool_close(lua_State *lua)
 {
-    int i=lua_gettop(lua);
-    return olua_bind_core(lua,i-1);
+    struct olua_pool *pool=olua_tohandle(lua,1,TNAME_POOL);
+
+    DEBUG( puts("olua_pool_close()") );
+    if( pool->spoolhp != NULL ){
+        ub4 busy=0;
+
+        if( OCIAttrGet( pool->spoolhp , OCI_HTYPE_SPOOL , (dvoid*)&busy ,
+                (ub4*)0 , OCI_ATTR_SPOOL_BUSY_COUNT , pool->errhp ) == OCI_SUCCESS
+            && busy > 0 )
+            return luaL_error(lua,"pool:close: %d sessions are still acquired",(int)busy);
+        OCISessionPoolDestroy( pool->spoolhp , pool->errhp , OCI_SPD_FORCE );
+        OCIHandleFree( pool->spoolhp , OCI_HTYPE_SPOOL );
+        pool->spoolhp = NULL;
+    }
+    if( pool->errhp != NULL ){
+        OCIHandleFree( pool->errhp , OCI_HTYPE_ERROR );
+        pool->errhp = NULL;
+    }
+    return 0;
 }
 
-/* olua_fetch_buffer_alloc */
-static struct olua_fetch_buffer *olua_fetch_buffer_alloc(
-    lua_State *lua ,
-    struct olua_statement *statement )
+/* lua-function: olua_pool_acquire
+ *  stack-in
+ *    (+1) pool-object
+ *    (+2) option-table same as oluacle.new (optional)
+ *  return
+ *    (+1) connection-object. its disconnect() returns the session to
+ *         the pool. without (+2), options are inherited from the table
+ *         given to oluacle.pool.
+ */
+static int olua_pool_acquire(lua_State *lua)
 {
-    sb4 parm_status;
-    dvoid *mypard;
-    ub4 counter=0;
+    struct olua_pool *pool=olua_tohandle(lua,1,TNAME_POOL);
+    OCIEnv *envhp=olua_envhp(lua);
+    OCISvcCtx *svchp=NULL;
+    OCIError *errhp=NULL;
+    unsigned long long start;
+    sword status;
 
-    struct olua_fetch_buffer dummyfirst;
-    struct olua_fetch_buffer *curr=&dummyfirst;
+    luaL_argcheck(lua,pool->spoolhp != NULL,1,"pool has been closed.");
 
-    DEBUG( puts("ENTER olua_fetch_buffer_alloc()") );
+    status = OCIHandleAlloc(envhp , (dvoid**)&errhp , OCI_HTYPE_ERROR , 0 , NULL );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,NULL,status);
+
+    start = olua_now();
+    status = OCISessionGet( envhp , errhp , &svchp , NULL ,
+                pool->name , pool->name_len ,
+                NULL , 0 , NULL , NULL , NULL , OCI_SESSGET_SPOOL );
+    pool->wait_ns += olua_now() - start;
+    pool->gets++;
+    if( status != OCI_SUCCESS ){
+        text errbuf[512];
+        sb4 errcode=0;
+
+        /* the message is in errhp, which is freed before the error */
+        errbuf[0] = '\0';
+        OCIErrorGet( (dvoid*)errhp , 1 , (text*)NULL , &errcode ,
+                errbuf , (ub4)sizeof(errbuf) , OCI_HTYPE_ERROR );
+        OCIHandleFree( errhp , OCI_HTYPE_ERROR );
+        luaL_where(lua,0);
+        return luaL_error(lua,"%sError - %s",lua_tostring(lua,-1),(char*)errbuf);
+    }
 
-    olua_fetch_buffer_new( &dummyfirst );
+    if( lua_istable(lua,2) ){
+        lua_pushvalue(lua,2);
+    }else{
+        lua_newtable(lua);
+        lua_createtable(lua,0,1);
+        lua_getfield(lua,1,"options");
+        lua_setfield(lua,-2,"__index");
+        lua_setmetatable(lua,-2);
+    }
+    olua_connection_new(lua,svchp,errhp,1);
 
-    while( (parm_status=OCIParamGet(
-                statement->stmthp ,
-                OCI_HTYPE_STMT ,
-                statement->errhp ,
-                &mypard ,
-                ++counter )) == OCI_SUCCESS )
-    {
-        sword status;
-        const char *colname;
-        ub4 colname_len;
+    /* member: pool (keeps the pool alive while the session is out) */
+    lua_pushvalue(lua,1);
+    lua_setfield(lua,-2,"pool");
+    return 1;
+}
 
-        if( (curr->next = olua_fetch_buffer_new(NULL)) == NULL ){
-            olua_fetch_buffer_gc( dummyfirst.next );
-            luaL_error(lua,"memory allocation error(1)");
-            return NULL;
+/* lua-function: olua_pool_stats
+ *  stack-in
+ *    (+1) pool-object
+ *  return
+ *    (+1) table { busy , open , gets , wait }
+ *         wait is the total seconds spent to get sessions.
+ */
+static int olua_pool_stats(lua_State *lua)
+{
+    struct olua_pool *pool=olua_tohandle(lua,1,TNAME_POOL);
+    ub4 busy=0 , open=0;
+    sword status;
+
+    luaL_argcheck(lua,pool->spoolhp != NULL,1,"pool has been closed.");
+    status = OCIAttrGet( pool->spoolhp , OCI_HTYPE_SPOOL , (dvoid*)&busy ,
+                (ub4*)0 , OCI_ATTR_SPOOL_BUSY_COUNT , pool->errhp );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,pool->errhp,status);
+    status = OCIAttrGet( pool->spoolhp , OCI_HTYPE_SPOOL , (dvoid*)&open ,
+                (ub4*)0 , OCI_ATTR_SPOOL_OPEN_COUNT , pool->errhp );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,pool->errhp,status);
+
+    lua_createtable(lua,0,4);
+    lua_pushinteger(lua,busy);
+    lua_setfield(lua,-2,"busy");
+    lua_pushinteger(lua,open);
+    lua_setfield(lua,-2,"open");
+    lua_pushnumber(lua,(lua_Number)pool->gets);
+    lua_setfield(lua,-2,"gets");
+    lua_pushnumber(lua,(lua_Number)pool->wait_ns / 1e9);
+    lua_setfield(lua,-2,"wait");
+    return 1;
+}
+
+/* Parallel query (pool:parallel): jobs are run on sessions of the pool
+ * by native threads. The threads never touch the lua_State: binds are
+ * copied out before they start, and rows are kept in C memory until all
+ * of them end and the calling thread makes them into tables.
+ */
+#ifdef _WIN32
+typedef CRITICAL_SECTION olua_mutex_t;
+#  define olua_mutex_init(m)    InitializeCriticalSection(m)
+#  define olua_mutex_lock(m)    EnterCriticalSection(m)
+#  define olua_mutex_unlock(m)  LeaveCriticalSection(m)
+#  define olua_mutex_destroy(m) DeleteCriticalSection(m)
+typedef HANDLE olua_thread_t;
+#else
+typedef pthread_mutex_t olua_mutex_t;
+#  define olua_mutex_init(m)    pthread_mutex_init(m,NULL)
+#  define olua_mutex_lock(m)    pthread_mutex_lock(m)
+#  define olua_mutex_unlock(m)  pthread_mutex_unlock(m)
+#  define olua_mutex_destroy(m) pthread_mutex_destroy(m)
+typedef pthread_t olua_thread_t;
+#endif
+
+/* a bind value copied out of Lua */
+struct olua_job_bind {
+    char *name;  /* ":NAME", or NULL to bind by position */
+    ub2 type;    /* SQLT_INT, SQLT_FLT or SQLT_STR */
+    sb2 ind;
+    sb4 size;
+    union{
+        sb8 integer;
+        double number;
+        char *string;
+    }u;
+};
+
+/* a column of a result. `type` is the define type, which also tells
+ * what a cell of the rows holds:
+ *   SQLT_INT: sb8 , SQLT_FLT: double , SQLT_CHR: ub4 length and bytes ,
+ *   SQLT_DAT , SQLT_TIMESTAMP , SQLT_TIMESTAMP_TZ: struct olua_datetime
+ */
+struct olua_job_column {
+    char *name;
+    ub2 type;
+    ub2 size;   /* bytes of a row in the define array */
+    ub4 dtype;  /* descriptor type of TIMESTAMP */
+    char *data;
+    sb2 *ind;
+    ub2 *len;
+};
+
+struct olua_job {
+    char *sql;
+    struct olua_job_bind *binds;
+    int nbinds;
+    int select;
+    ub4 rowcount;  /* rows of the result, or rows processed by DML */
+    struct olua_job_column *cols;
+    int ncols;
+    char *rows;    /* cells of all rows: a flag byte (0:NULL) and the value */
+    size_t rows_len;
+    size_t rows_size;
+    char *error;
+};
+
+struct olua_parallel {
+    OCIEnv *envhp;
+    struct olua_pool *pool;
+    struct olua_job *jobs;
+    int njobs;
+    int next;       /* index of the next job to take */
+    ub4 fetch_size;
+    int commit;
+    int locked;     /* the mutex has been initialized */
+    olua_mutex_t mutex;
+};
+
+static char olua_empty[1];
+
+static void olua_job_error(struct olua_job *job,OCIError *errhp,const char *message)
+{
+    char buffer[512];
+    sb4 errcode=0;
+
+    if( job->error != NULL )
+        return;
+    if( message == NULL ){
+        buffer[0] = '\0';
+        OCIErrorGet( errhp , 1 , NULL , &errcode , (OraText*)buffer ,
+                sizeof(buffer) , OCI_HTYPE_ERROR );
+        message = buffer;
+    }
+    if( (job->error = malloc(strlen(message)+1)) != NULL )
+        strcpy(job->error,message);
+}
+
+/* append `size` bytes to the rows of the job */
+static int olua_job_append(struct olua_job *job,const void *p,size_t size)
+{
+    if( job->rows_len + size > job->rows_size ){
+        size_t n=job->rows_size ? job->rows_size : 4096;
+        char *rows;
+
+        while( n < job->rows_len + size )
+            n *= 2;
+        /* not realloc, to be traced by MEMORY_TEST */
+        if( (rows = malloc(n)) == NULL )
+            return 0;
+        if( job->rows != NULL ){
+            memcpy(rows,job->rows,job->rows_len);
+            free(job->rows);
         }
-        curr = curr->next;
+        job->rows = rows;
+        job->rows_size = n;
+    }
+    memcpy(job->rows + job->rows_len , p , size);
+    job->rows_len += size;
+    return 1;
+}
 
-        /* f[^TCY擾 */
-        status = OCIAttrGet(
-            mypard ,
-            (ub4)OCI_DTYPE_PARAM ,
-            (dvoid*)&curr->size ,
-            (ub4)0 ,
-            (ub4)OCI_ATTR_DATA_SIZE , 
-            statement->errhp
-        );
-        if( status != OCI_SUCCESS ){
-            DEBUG( puts("can not get datasize") );
-            olua_fetch_buffer_gc(dummyfirst.next);
-            checkerr(lua,statement->errhp,status);
-            return NULL;
+/* free the define arrays. names and types are kept for the rows. */
+static void olua_job_freedefines(struct olua_job *job,ub4 fetch_size)
+{
+    int i;
+
+    for( i=0 ; i < job->ncols ; i++ ){
+        struct olua_job_column *col=&job->cols[i];
+        ub4 r;
+
+        if( col->data == NULL )
+            continue;
+        if( col->dtype != 0 ){
+            for( r=0 ; r < fetch_size ; r++ ){
+                dvoid *desc=((dvoid**)col->data)[r];
+                if( desc != NULL )
+                    OCIDescriptorFree( desc , col->dtype );
+            }
         }
-        DEBUG( printf("DATASIZE=%d\n",curr->size) );
+        free(col->data);
+        col->data = NULL;
+    }
+}
 
-        /* f[^擾 */
-        status = OCIAttrGet(
-            (dvoid*)mypard , (ub4)OCI_DTYPE_PARAM ,
-            (dvoid*)&curr->type , 
-            (ub4)0 ,
-            (ub4)OCI_ATTR_DATA_TYPE , 
-            statement->errhp
-        );
+/* olua_job_describe
+ *   make the columns and define arrays of the executed SELECT.
+ * return
+ *   0 on error (set to the job)
+ */
+static int olua_job_describe(
+    struct olua_parallel *par ,
+    struct olua_job *job ,
+    OCIStmt *stmthp ,
+    OCIError *errhp )
+{
+    ub4 count=0;
+    ub4 i;
+    sword status;
+
+    status = OCIAttrGet( stmthp , OCI_HTYPE_STMT , (dvoid*)&count , NULL ,
+                OCI_ATTR_PARAM_COUNT , errhp );
+    if( status != OCI_SUCCESS ){
+        olua_job_error(job,errhp,NULL);
+        return 0;
+    }
+    if( (job->cols = malloc(sizeof(struct olua_job_column)*(count ? count : 1))) == NULL ){
+        olua_job_error(job,errhp,"memory allocation error");
+        return 0;
+    }
+    for( i=0 ; i < count ; i++ ){
+        job->cols[i].name = NULL;
+        job->cols[i].data = NULL;
+        job->cols[i].dtype = 0;
+    }
+    job->ncols = (int)count;
+
+    for( i=0 ; i < count ; i++ ){
+        struct olua_job_column *col=&job->cols[i];
+        OCIDefine *dfp=NULL;
+        dvoid *param;
+        const char *colname;
+        ub4 colname_len=0;
+        size_t data_size;
+        ub2 size=0;
+
+        status = OCIParamGet( stmthp , OCI_HTYPE_STMT , errhp , &param , i+1 );
+        if( status == OCI_SUCCESS )
+            status = OCIAttrGet( param , OCI_DTYPE_PARAM , (dvoid*)&size , NULL ,
+                        OCI_ATTR_DATA_SIZE , errhp );
+        if( status == OCI_SUCCESS )
+            status = OCIAttrGet( param , OCI_DTYPE_PARAM , (dvoid*)&col->type , NULL ,
+                        OCI_ATTR_DATA_TYPE , errhp );
+        if( status == OCI_SUCCESS )
+            status = OCIAttrGet( param , OCI_DTYPE_PARAM , (dvoid*)&colname , &colname_len ,
+                        OCI_ATTR_NAME , errhp );
         if( status != OCI_SUCCESS ){
-            olua_fetch_buffer_gc(dummyfirst.next);
-            checkerr(lua,statement->errhp,status);
-            return NULL;
+            olua_job_error(job,errhp,NULL);
+            return 0;
         }
-        DEBUG( printf("DATATYPE=%d\n" , curr->type ) );
-
-        if( curr->type == SQLT_NUM ){
-            curr->type = SQLT_FLT;
-            curr->size = sizeof(double);
-        }else if( curr->type == SQLT_DAT ){
-            curr->type = SQLT_STR;
-            curr->size = 32;
+        if( (col->name = malloc(colname_len+1)) == NULL ){
+            olua_job_error(job,errhp,"memory allocation error");
+            return 0;
         }
-        /* ̈m */
-        if( (curr->u.pointor = malloc(curr->size+1))==NULL ){
-            olua_fetch_buffer_gc( dummyfirst.next );
-            luaL_error(lua,"olua_fetch_buffer_alloc(): memory allocation error");
-            return NULL;
+        memcpy(col->name,colname,colname_len);
+        col->name[colname_len] = '\0';
+
+        /* same conversions as olua_fetch_buffer_alloc */
+        switch( col->type ){
+        case SQLT_NUM:
+            {
+                sb2 precision=0;
+                sb1 scale=0;
+
+                OCIAttrGet( param , OCI_DTYPE_PARAM , (dvoid*)&precision , NULL ,
+                        OCI_ATTR_PRECISION , errhp );
+                OCIAttrGet( param , OCI_DTYPE_PARAM , (dvoid*)&scale , NULL ,
+                        OCI_ATTR_SCALE , errhp );
+                if( scale == 0 && precision > 0 && precision <= 18 ){
+                    col->type = SQLT_INT;
+                    col->size = sizeof(sb8);
+                }else{
+                    col->type = SQLT_FLT;
+                    col->size = sizeof(double);
+                }
+            }
+            break;
+        case SQLT_DAT:
+            col->size = 7;
+            break;
+        case SQLT_TIMESTAMP:
+            col->dtype = OCI_DTYPE_TIMESTAMP;
+            col->size = sizeof(OCIDateTime*);
+            break;
+        case SQLT_TIMESTAMP_TZ:
+        case SQLT_TIMESTAMP_LTZ:
+            col->type = SQLT_TIMESTAMP_TZ;
+            col->dtype = OCI_DTYPE_TIMESTAMP_TZ;
+            col->size = sizeof(OCIDateTime*);
+            break;
+        case SQLT_CLOB:
+        case SQLT_BLOB:
+            olua_job_error(job,errhp,"LOB columns are not supported by parallel");
+            return 0;
+        default:
+            /* as text. RAW becomes hexadecimal digits. */
+            if( col->type == SQLT_BIN && size < 32768 )
+                size *= 2;
+            col->type = SQLT_CHR;
+            col->size = size < 64 ? 64 : size;
+            break;
         }
 
-        /* 񖼎擾 */
-        status = OCIAttrGet(
-            (dvoid*)mypard, (ub4)OCI_DTYPE_PARAM ,
-            (dvoid*)&colname ,
-            &colname_len ,
-            (ub4)OCI_ATTR_NAME ,
-            statement->errhp 
-        );
-        if( status != OCI_SUCCESS ){
-            olua_fetch_buffer_gc(dummyfirst.next);
-            checkerr(lua,statement->errhp,status);
-            abort();
+        data_size = OLUA_ALIGN( (size_t)col->size * par->fetch_size );
+        if( (col->data = malloc(data_size +
+                par->fetch_size * (sizeof(sb2)+sizeof(ub2)))) == NULL ){
+            olua_job_error(job,errhp,"memory allocation error");
+            return 0;
         }
-        if( (curr->name = malloc( colname_len+1 )) == NULL ){
-            olua_fetch_buffer_gc( dummyfirst.next );
-            luaL_error(lua,"olua_fetch_buffer_alloc(): memory allocation error");
-            return NULL;
+        col->ind = (sb2*)( col->data + data_size );
+        col->len = (ub2*)( col->ind + par->fetch_size );
+        if( col->dtype != 0 ){
+            dvoid **desc=(dvoid**)col->data;
+            ub4 r;
+
+            for( r=0 ; r < par->fetch_size ; r++ )
+                desc[r] = NULL;
+            for( r=0 ; r < par->fetch_size ; r++ ){
+                if( OCIDescriptorAlloc( par->envhp , &desc[r] , col->dtype , 0 , NULL ) != OCI_SUCCESS ){
+                    olua_job_error(job,errhp,"descriptor allocation error");
+                    return 0;
+                }
+            }
+        }
+        status = OCIDefineByPos( stmthp , &dfp , errhp , i+1 , col->data ,
+                    col->size , col->type , col->ind , col->len , (ub2*)NULL ,
+                    OCI_DEFAULT );
+        if( status != OCI_SUCCESS ){
+            olua_job_error(job,errhp,NULL);
+            return 0;
         }
-        memcpy( curr->name , colname , colname_len ); 
-        curr->name[ colname_len ] = '\0';
-        DEBUG( printf("COLUMN=[%.*s](%d)\n" , colname_len , colname , colname_len ));
     }
-    DEBUG(puts("ENTER: OCIDefineByPos"));
+    return 1;
+}
 
-    counter=0;
-    for( curr=dummyfirst.next ; curr != NULL ; curr=curr->next ){
-        OCIDefine *dfp=NULL;
-        sword status;
+/* olua_job_fetch
+ *   copy all rows of the cursor into the rows of the job.
+ */
+static void olua_job_fetch(
+    struct olua_parallel *par ,
+    struct olua_job *job ,
+    OCIStmt *stmthp ,
+    OCIError *errhp )
+{
+    struct olua_datetime dt;
+    sword status;
 
-        status = OCIDefineByPos(
-            statement->stmthp ,
-            &dfp ,
-            statement->errhp ,
-            ++counter ,
-            curr->u.pointor ,
-            curr->size ,
-            curr->type ,
-            &curr->ind  ,
-            &curr->len ,
-            (ub4)NULL,
-            OCI_DEFAULT
-        );
-        if( status != OCI_SUCCESS ){
-            olua_fetch_buffer_gc( dummyfirst.next );
-            checkerr( lua , statement->errhp , status );
-            return NULL;
+    do{
+        ub4 rows=0 , r;
+        int c;
+
+        status = OCIStmtFetch2( stmthp , errhp , par->fetch_size , OCI_FETCH_NEXT , 0 , OCI_DEFAULT );
+        if( status != OCI_SUCCESS && status != OCI_NO_DATA ){
+            olua_job_error(job,errhp,NULL);
+            return;
+        }
+        if( OCIAttrGet( stmthp , OCI_HTYPE_STMT , (dvoid*)&rows , NULL ,
+                    OCI_ATTR_ROWS_FETCHED , errhp ) != OCI_SUCCESS ){
+            olua_job_error(job,errhp,NULL);
+            return;
+        }
+        for( r=0 ; r < rows ; r++ ){
+            for( c=0 ; c < job->ncols ; c++ ){
+                struct olua_job_column *col=&job->cols[c];
+                char *value=col->data + (size_t)col->size * r;
+                char flag=( col->ind[r] == 0 );
+                ub4 len;
+                int ok;
+
+                ok = olua_job_append(job,&flag,1);
+                if( ok && flag ){
+                    switch( col->type ){
+                    case SQLT_INT:
+                    case SQLT_FLT:
+                        ok = olua_job_append(job,value,8);
+                        break;
+                    case SQLT_DAT:
+                        olua_decode_date((ub1*)value,&dt);
+                        ok = olua_job_append(job,&dt,sizeof(dt));
+                        break;
+                    case SQLT_TIMESTAMP:
+                    case SQLT_TIMESTAMP_TZ:
+                        olua_decode_timestamp(par->envhp,errhp,*(OCIDateTime**)value,
+                            col->type == SQLT_TIMESTAMP_TZ,&dt);
+                        ok = olua_job_append(job,&dt,sizeof(dt));
+                        break;
+                    default:
+                        len = col->len[r];
+                        ok = olua_job_append(job,&len,sizeof(len)) &&
+                             olua_job_append(job,value,len);
+                        break;
+                    }
+                }
+                if( ! ok ){
+                    olua_job_error(job,errhp,"memory allocation error");
+                    return;
+                }
+            }
+        }
+        job->rowcount += rows;
+    }while( status != OCI_NO_DATA );
+}
+
+/* olua_job_run
+ *   run a job on the session `svchp`. called by a worker thread.
+ */
+static void olua_job_run(
+    struct olua_parallel *par ,
+    struct olua_job *job ,
+    OCISvcCtx *svchp ,
+    OCIError *errhp )
+{
+    OCIStmt *stmthp=NULL;
+    ub2 type=0;
+    int i , pos=0;
+    sword status;
+
+    if( OCIHandleAlloc( par->envhp , (dvoid**)&stmthp , OCI_HTYPE_STMT , 0 , NULL ) != OCI_SUCCESS ){
+        olua_job_error(job,errhp,"statement handle allocation error");
+        return;
+    }
+    status = OCIStmtPrepare( stmthp , errhp , (OraText*)job->sql , (ub4)strlen(job->sql) ,
+                OCI_NTV_SYNTAX , OCI_DEFAULT );
+    for( i=0 ; status == OCI_SUCCESS && i < job->nbinds ; i++ ){
+        struct olua_job_bind *b=&job->binds[i];
+        OCIBind *bindp=NULL;
+        dvoid *valuep=( b->type == SQLT_STR ? (dvoid*)b->u.string : (dvoid*)&b->u );
+
+        if( b->name != NULL ){
+            status = OCIBindByName( stmthp , &bindp , errhp , (OraText*)b->name ,
+                        (sb4)strlen(b->name) , valuep , b->size , b->type , &b->ind ,
+                        NULL , NULL , 0 , NULL , OCI_DEFAULT );
+        }else{
+            status = OCIBindByPos( stmthp , &bindp , errhp , ++pos ,
+                        valuep , b->size , b->type , &b->ind ,
+                        NULL , NULL , 0 , NULL , OCI_DEFAULT );
         }
     }
-    if( statement->fetch_buffer != NULL ){
-        olua_fetch_buffer_gc( statement->fetch_buffer );
-        statement->fetch_buffer = NULL;
+    if( status == OCI_SUCCESS )
+        status = OCIAttrGet( stmthp , OCI_HTYPE_STMT , (dvoid*)&type , NULL ,
+                    OCI_ATTR_STMT_TYPE , errhp );
+    job->select = ( type == OCI_STMT_SELECT );
+    if( status == OCI_SUCCESS )
+        status = OCIStmtExecute( svchp , stmthp , errhp , job->select ? 0 : 1 ,
+                    0 , NULL , NULL , OCI_DEFAULT );
+    if( status != OCI_SUCCESS ){
+        olua_job_error(job,errhp,NULL);
+    }else if( job->select ){
+        if( olua_job_describe(par,job,stmthp,errhp) )
+            olua_job_fetch(par,job,stmthp,errhp);
+        olua_job_freedefines(job,par->fetch_size);
+    }else{
+        status = OCIAttrGet( stmthp , OCI_HTYPE_STMT , (dvoid*)&job->rowcount , NULL ,
+                    OCI_ATTR_ROW_COUNT , errhp );
+        if( status == OCI_SUCCESS && par->commit )
+            status = OCITransCommit( svchp , errhp , OCI_DEFAULT );
+        if( status != OCI_SUCCESS )
+            olua_job_error(job,errhp,NULL);
     }
-    
-    DEBUG( printf("LEAVE olua_fetch_buffer_alloc(%p)\n",dummyfirst.next) );
-    return statement->fetch_buffer = dummyfirst.next;
+    OCIHandleFree( stmthp , OCI_HTYPE_STMT );
 }
 
-/** olua_execute
- * stack-in:
- *   (-1) statement-handle
- * stack-out:
- *   nothing
+static struct olua_job *olua_parallel_take(struct olua_parallel *par)
+{
+    struct olua_job *job=NULL;
+
+    olua_mutex_lock(&par->mutex);
+    if( par->next < par->njobs )
+        job = &par->jobs[ par->next++ ];
+    olua_mutex_unlock(&par->mutex);
+    return job;
+}
+
+/* olua_parallel_worker
+ *   take jobs one by one and run them on one session of the pool.
  */
-static int olua_execute(lua_State *lua)
+static void olua_parallel_worker(struct olua_parallel *par)
 {
-    struct olua_statement *statement = olua_tohandle(lua,-1,TNAME_STATEMENT);
-    OCISvcCtx **conn;
+    OCIError *errhp=NULL;
+    OCISvcCtx *svchp=NULL;
+    struct olua_job *job;
+    unsigned long long start;
     sword status;
-    ub2 type;
-    ub4 iters;
 
-    DEBUG( puts("ENTER: olua_execute()") );
+    if( OCIHandleAlloc( par->envhp , (dvoid**)&errhp , OCI_HTYPE_ERROR , 0 , NULL ) != OCI_SUCCESS ){
+        while( (job = olua_parallel_take(par)) != NULL )
+            olua_job_error(job,NULL,"error handle allocation error");
+        return;
+    }
+    start = olua_now();
+    status = OCISessionGet( par->envhp , errhp , &svchp , NULL ,
+                par->pool->name , par->pool->name_len ,
+                NULL , 0 , NULL , NULL , NULL , OCI_SESSGET_SPOOL );
+    olua_mutex_lock(&par->mutex);
+    par->pool->wait_ns += olua_now() - start;
+    par->pool->gets++;
+    olua_mutex_unlock(&par->mutex);
+
+    while( (job = olua_parallel_take(par)) != NULL ){
+        if( status != OCI_SUCCESS )
+            olua_job_error(job,errhp,NULL);
+        else
+            olua_job_run(par,job,svchp,errhp);
+    }
+    if( status == OCI_SUCCESS ){
+        OCITransRollback( svchp , errhp , OCI_DEFAULT );
+        OCISessionRelease( svchp , errhp , NULL , 0 , OCI_DEFAULT );
+    }
+    OCIHandleFree( errhp , OCI_HTYPE_ERROR );
+}
 
-    /* get connection */
-    lua_getfield(lua,-1,"connection");
-    conn = olua_tohandle(lua,-1,TNAME_CONNECTION);
-    lua_pop(lua,1);
-    
-    if( statement->stmthp == NULL)
-        return luaL_error(lua,"olua_execute: stmt handle is nil.");
+#ifdef _WIN32
+static DWORD WINAPI olua_parallel_main(LPVOID arg)
+{
+    olua_parallel_worker(arg);
+    return 0;
+}
+#else
+static void *olua_parallel_main(void *arg)
+{
+    olua_parallel_worker(arg);
+    return NULL;
+}
+#endif
 
-    status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
-		(dvoid *)&type, (ub4 *)0, (ub4)OCI_ATTR_STMT_TYPE, statement->errhp);
-    if( status != OCI_SUCCESS )
-        return checkerr(lua,statement->errhp,status);
-    
-    if (type == OCI_STMT_SELECT)
-        iters = 0;
-    else
-        iters = 1;
+/* lua-function: olua_parallel_gc
+ *  stack-in
+ *    (+1) userdata of struct olua_parallel
+ */
+static int olua_parallel_gc(lua_State *lua)
+{
+    struct olua_parallel *par=lua_touserdata(lua,1);
+    int i , j;
+
+    for( i=0 ; par->jobs != NULL && i < par->njobs ; i++ ){
+        struct olua_job *job=&par->jobs[i];
+
+        if( job->sql != NULL )
+            free(job->sql);
+        for( j=0 ; j < job->nbinds ; j++ ){
+            if( job->binds[j].name != NULL )
+                free(job->binds[j].name);
+            if( job->binds[j].type == SQLT_STR && job->binds[j].u.string != olua_empty )
+                free(job->binds[j].u.string);
+        }
+        if( job->binds != NULL )
+            free(job->binds);
+        for( j=0 ; j < job->ncols ; j++ ){
+            if( job->cols[j].name != NULL )
+                free(job->cols[j].name);
+        }
+        if( job->cols != NULL )
+            free(job->cols);
+        if( job->rows != NULL )
+            free(job->rows);
+        if( job->error != NULL )
+            free(job->error);
+    }
+    if( par->jobs != NULL )
+        free(par->jobs);
+    par->jobs = NULL;
+    if( par->locked )
+        olua_mutex_destroy(&par->mutex);
+    par->locked = 0;
+    return 0;
+}
 
-    DEBUG( puts("call OCIStmtExecute()") );
-    status = OCIStmtExecute(*conn,statement->stmthp,statement->errhp,iters,0,NULL,NULL,OCI_DEFAULT);
-    if( status != OCI_SUCCESS )
-        return checkerr(lua,statement->errhp,status);
-    
-    if( type == OCI_STMT_SELECT ){
-        olua_fetch_buffer_alloc(lua,statement);
-        lua_pushcfunction(lua,olua_fetch);
-        lua_insert(lua,-2);
-        DEBUG( puts("LEAVE: olua_execute(OCI_STMT_SELECT)") );
-        return 2;
+/* olua_job_setbind
+ *   copy the value at `index` into `b`. `name` is the key of a named bind.
+ * return
+ *   0 on memory allocation error
+ */
+static int olua_job_setbind(lua_State *lua,int index,struct olua_job_bind *b,const char *name)
+{
+    b->name = NULL;
+    b->ind = 0;
+    b->type = SQLT_STR;
+    b->u.string = olua_empty;
+    b->size = 1;
+    if( name != NULL ){
+        if( (b->name = malloc(strlen(name)+2)) == NULL )
+            return 0;
+        if( name[0] == ':' ){
+            strcpy(b->name,name);
+        }else{
+            b->name[0] = ':';
+            strcpy(b->name+1,name);
+        }
+    }
+    if( ! lua_toboolean(lua,index) ){
+        b->ind = OCI_IND_NULL;
+    }else if( lua_type(lua,index) == LUA_TNUMBER ){
+        if( olua_isinteger(lua,index,&b->u.integer) ){
+            b->type = SQLT_INT;
+            b->size = sizeof(sb8);
+        }else{
+            b->type = SQLT_FLT;
+            b->u.number = lua_tonumber(lua,index);
+            b->size = sizeof(double);
+        }
     }else{
-        ub4 rowcount;
-        status = OCIAttrGet(statement->stmthp, (ub4) OCI_HTYPE_STMT,
-                    (dvoid *)&rowcount, (ub4 *)0, (ub4)OCI_ATTR_ROW_COUNT, statement->errhp);
-        if( status != OCI_SUCCESS )
-            return checkerr(lua,statement->errhp,status);
-        
-        DEBUG( puts("LEAVE: olua_execute(! OCI_STMT_SELECT)") );
-        lua_pushinteger(lua,rowcount);
-        return 1;
+        size_t len;
+        const char *s=luaL_tolstring(lua,index,&len);
+
+        if( (b->u.string = malloc(len+1)) == NULL ){
+            b->u.string = olua_empty;
+            if( b->name != NULL )
+                free(b->name);
+            b->name = NULL;
+            lua_pop(lua,1);
+            return 0;
+        }
+        memcpy(b->u.string,s,len+1);
+        b->size = (sb4)len+1;
+        lua_pop(lua,1);
     }
+    return 1;
 }
 
-/** olua_fetch 
- *
- * stack-in:
- *   (+1) statement-handle
- * stack-out:
- *   (+1) column table.
+/* olua_job_new
+ *   copy the job-table { sql=.. , binds=.. } at the top into `job`.
  */
-static int olua_fetch(lua_State *lua)
+static void olua_job_new(lua_State *lua,struct olua_job *job,int n)
 {
-    struct olua_statement *statement=olua_tohandle(lua,1,TNAME_STATEMENT);
-    struct olua_fetch_buffer *fetch_buffer=NULL;
-
-    sword status;
-    int counter=0;
-
-    DEBUG( puts("ENTER: olua_fetch()") );
-
-    if( statement == NULL )
-        return luaL_error(lua,"error: invalid parameter(statement==NULL)");
-
-    fetch_buffer = statement->fetch_buffer ;
+    int t=lua_gettop(lua);
+    const char *sql;
+    int count=0;
+
+    if( ! lua_istable(lua,t) )
+        luaL_error(lua,"job #%d is not a table",n);
+    lua_getfield(lua,t,"sql");
+    if( (sql = lua_tostring(lua,-1)) == NULL )
+        luaL_error(lua,"job #%d has no sql",n);
+    if( (job->sql = malloc(strlen(sql)+1)) == NULL )
+        luaL_error(lua,"memory allocation error");
+    strcpy(job->sql,sql);
+    lua_pop(lua,1);
 
-    status = OCIStmtFetch2(
-            statement->stmthp ,
-            statement->errhp ,
-            (ub4)1 ,
-            OCI_FETCH_NEXT ,
-            0 ,
-            OCI_DEFAULT );
+    lua_getfield(lua,t,"binds");
+    if( lua_istable(lua,-1) ){
+        int positional=(int)lua_rawlen(lua,-1);
 
-    if( status == OCI_NO_DATA){
-        statement=lua_touserdata(lua,-1);
-        olua_statement_gc(lua);
-        lua_pushnil(lua);
-        return 1;
-    }
-    if( status != OCI_SUCCESS )
-        return checkerr(lua,statement->errhp,status);
-    
-    DEBUG( puts("push fetch values") );
-    DEBUG( fflush(stdout) );
-    
-    lua_newtable(lua);
-    for( counter=1 ; fetch_buffer != NULL ; ++counter ){
-        lua_pushstring(lua,fetch_buffer->name);
-        lua_pushinteger(lua,counter);
-        if( fetch_buffer->ind != 0 ){ /* NULL VALUE */
-            lua_getfield(lua,1,"connection");
-            lua_getfield(lua,-1,"null");
-            if( lua_isnil(lua,-1) ){
+        if( positional > 0 ){
+            count = positional;
+        }else{
+            lua_pushnil(lua);
+            while( lua_next(lua,-2) ){
                 lua_pop(lua,1);
-                lua_pushboolean(lua,0);
+                count++;
             }
-            lua_remove(lua,-2);
-            DEBUG(puts("ind==0"));
-        }else{ /* NOT NULL */
-            switch( fetch_buffer->type ){
-            case SQLT_STR:
-            case SQLT_CHR:
-            case SQLT_VCS:
-            case SQLT_AFC:
-                lua_pushlstring(lua,fetch_buffer->u.string,fetch_buffer->len);
-                break;
+        }
+        if( count > 0 && (job->binds = malloc(sizeof(struct olua_job_bind)*count)) == NULL )
+            luaL_error(lua,"memory allocation error");
+        if( positional > 0 ){
+            for( ; job->nbinds < count ; job->nbinds++ ){
+                lua_rawgeti(lua,-1,job->nbinds+1);
+                if( ! olua_job_setbind(lua,-1,&job->binds[job->nbinds],NULL) )
+                    luaL_error(lua,"memory allocation error");
+                lua_pop(lua,1);
+            }
+        }else{
+            lua_pushnil(lua);
+            while( job->nbinds < count && lua_next(lua,-2) ){
+                if( lua_type(lua,-2) != LUA_TSTRING )
+                    luaL_error(lua,"job #%d: bind name must be a string",n);
+                if( ! olua_job_setbind(lua,-1,&job->binds[job->nbinds],lua_tostring(lua,-2)) )
+                    luaL_error(lua,"memory allocation error");
+                job->nbinds++;
+                lua_pop(lua,1);
+            }
+        }
+    }
+    lua_settop(lua,t);
+}
+
+/* olua_job_push
+ *   push the rows of the job as an array of tables.
+ *   stack-in:
+ *     (null) value for NULL
+ */
+static void olua_job_push(lua_State *lua,struct olua_job *job,int named,int date,int null)
+{
+    const char *p=job->rows;
+    struct olua_datetime dt;
+    ub4 r;
+    int c;
+
+    lua_createtable(lua,(int)(job->rowcount < 65536 ? job->rowcount : 65536),0);
+    for( r=0 ; r < job->rowcount ; r++ ){
+        lua_createtable(lua,job->ncols,named ? job->ncols : 0);
+        for( c=0 ; c < job->ncols ; c++ ){
+            struct olua_job_column *col=&job->cols[c];
+            sb8 integer;
+            double number;
+            ub4 len;
+
+            if( *p++ == 0 ){
+                lua_pushvalue(lua,null);
+            }else switch( col->type ){
             case SQLT_INT:
-                lua_pushinteger(lua,*fetch_buffer->u.integer);
+                memcpy(&integer,p,sizeof(integer));
+                p += sizeof(integer);
+                olua_pushint64(lua,integer);
                 break;
-            /* case SQLT_BDOUBLE: */
-            /* case SQLT_BFLOAT: */
             case SQLT_FLT:
-                lua_pushnumber(lua,*fetch_buffer->u.number);
+                memcpy(&number,p,sizeof(number));
+                p += sizeof(number);
+                lua_pushnumber(lua,number);
                 break;
-            case SQLT_ODT:
-            case SQLT_DATE:
+            case SQLT_DAT:
             case SQLT_TIMESTAMP:
             case SQLT_TIMESTAMP_TZ:
-            case SQLT_TIMESTAMP_LTZ:
+                memcpy(&dt,p,sizeof(dt));
+                p += sizeof(dt);
+                olua_pushdatetime(lua,date,&dt);
+                break;
             default:
-                lua_pushnil(lua);
+                memcpy(&len,p,sizeof(len));
+                p += sizeof(len);
+                lua_pushlstring(lua,p,len);
+                p += len;
                 break;
             }
+            if( named ){
+                lua_pushvalue(lua,-1);
+                lua_setfield(lua,-3,col->name);
+            }
+            lua_rawseti(lua,-2,c+1);
         }
-        lua_pushvalue(lua,-1);
-        lua_insert(lua,-3);
-        /* 1:table
-         * 2:key-string
-         * 3:value
-         * 4:counter
-         * 5:value
-         */
-        lua_settable(lua,-5);
-        lua_settable(lua,-3);
-        fetch_buffer = fetch_buffer->next;
+        lua_rawseti(lua,-2,(int)r+1);
     }
-    DEBUG( puts("LEAVE: olua_fetch(successfully)") );
-    return 1;
 }
 
+/* lua-function: olua_pool_parallel
+ *  stack-in
+ *    (+1) pool-object
+ *    (+2) array of jobs: { sql=SQL [,binds={B1,B2..} or {V1=B1..}] }
+ *    (+3) { threads=N , commit=BOOL , fetch_size= , mode= , date= , null= }
+ *         (optional) the options not given are taken from the pool's.
+ *  return
+ *    (+1) array of results: an array of rows for SELECT, or the number
+ *         of rows processed for others.
+ *    (+2) table: index of the job => error-message
+ */
+static int olua_pool_parallel(lua_State *lua)
+{
+    struct olua_pool *pool=olua_tohandle(lua,1,TNAME_POOL);
+    struct olua_parallel *par;
+    olua_thread_t *threads;
+    lua_Integer nthreads , fetch_size;
+    int started=0 , named , date , i , n;
+
+    luaL_argcheck(lua,pool->spoolhp != NULL,1,"pool has been closed.");
+    luaL_checktype(lua,2,LUA_TTABLE);
+    if( ! lua_istable(lua,3) ){
+        lua_settop(lua,2);
+        lua_newtable(lua);
+    }
+    lua_settop(lua,3);
+    lua_getfield(lua,LUA_REGISTRYINDEX,TNAME_THREADED);
+    if( ! lua_toboolean(lua,-1) )
+        return luaL_error(lua,"parallel needs oluacle.environ{ threaded=true } before connecting");
+    lua_pop(lua,1);
+    n = (int)lua_rawlen(lua,2);
 
-/** olua_exec
+    /* options: 4:options of the pool 5:threads 6:fetch_size 7:commit
+     *          8:mode 9:date 10:null */
+    lua_getfield(lua,1,"options");
+    if( ! lua_istable(lua,4) ){
+        lua_pop(lua,1);
+        lua_newtable(lua);
+    }
+    {
+        static const char *const names[]={
+            "threads" , "fetch_size" , "commit" , "mode" , "date" , "null" , NULL };
+        for( i=0 ; names[i] != NULL ; i++ ){
+            lua_getfield(lua,3,names[i]);
+            if( lua_isnil(lua,-1) ){
+                lua_pop(lua,1);
+                lua_getfield(lua,4,names[i]);
+            }
+        }
+    }
+    nthreads = luaL_optinteger(lua,5,pool->max);
+    if( nthreads > n )
+        nthreads = n;
+    if( nthreads < 1 )
+        nthreads = 1;
+    fetch_size = luaL_optinteger(lua,6,OLUA_DEFAULT_FETCH_SIZE);
+    named = ( olua_checkenum(lua,8,"mode",olua_modes,OLUA_MODE_TABLE) != OLUA_MODE_ARRAY );
+    date = olua_checkenum(lua,9,"date",olua_dates,OLUA_DATE_STRING);
+    if( lua_isnil(lua,10) ){
+        lua_pushboolean(lua,0);
+        lua_replace(lua,10);
+    }
+
+    /* 11: parallel (freed by the garbage collector even on errors) */
+    par = lua_newuserdata(lua,sizeof(struct olua_parallel));
+    par->envhp = olua_envhp(lua);
+    par->pool = pool;
+    par->jobs = NULL;
+    par->njobs = 0;
+    par->next = 0;
+    par->fetch_size = fetch_size > 0 ? (ub4)fetch_size : 1;
+    par->commit = lua_toboolean(lua,7);
+    par->locked = 0;
+    if( luaL_newmetatable(lua,TNAME_PARALLEL) ){
+        lua_pushcfunction(lua,olua_parallel_gc);
+        lua_setfield(lua,-2,"__gc");
+    }
+    lua_setmetatable(lua,-2);
+
+    if( n > 0 && (par->jobs = malloc(sizeof(struct olua_job)*n)) == NULL )
+        return luaL_error(lua,"memory allocation error");
+    for( i=0 ; i < n ; i++ ){
+        struct olua_job *job=&par->jobs[i];
+
+        job->sql = NULL;
+        job->binds = NULL;
+        job->nbinds = 0;
+        job->select = 0;
+        job->rowcount = 0;
+        job->cols = NULL;
+        job->ncols = 0;
+        job->rows = NULL;
+        job->rows_len = 0;
+        job->rows_size = 0;
+        job->error = NULL;
+        par->njobs++;
+        lua_rawgeti(lua,2,i+1);
+        olua_job_new(lua,job,i+1);
+        lua_pop(lua,1);
+    }
+
+    /* 12: threads */
+    threads = lua_newuserdata(lua,sizeof(olua_thread_t)*(size_t)nthreads);
+    olua_mutex_init(&par->mutex);
+    par->locked = 1;
+    DEBUG( printf("olua_pool_parallel: %d jobs on %d threads\n",n,(int)nthreads) );
+    for( i=0 ; i < nthreads ; i++ ){
+#ifdef _WIN32
+        if( (threads[started] = CreateThread(NULL,0,olua_parallel_main,par,0,NULL)) != NULL )
+            started++;
+#else
+        if( pthread_create(&threads[started],NULL,olua_parallel_main,par) == 0 )
+            started++;
+#endif
+    }
+    if( started == 0 )
+        olua_parallel_worker(par);
+    for( i=0 ; i < started ; i++ ){
+#ifdef _WIN32
+        WaitForSingleObject(threads[i],INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i],NULL);
+#endif
+    }
+
+    /* 13: results 14: errors */
+    lua_createtable(lua,n,0);
+    lua_newtable(lua);
+    for( i=0 ; i < n ; i++ ){
+        struct olua_job *job=&par->jobs[i];
+
+        if( job->error != NULL ){
+            lua_pushstring(lua,job->error);
+            lua_rawseti(lua,14,i+1);
+            lua_pushboolean(lua,0);
+        }else if( job->select ){
+            olua_job_push(lua,job,named,date,10);
+        }else{
+            lua_pushinteger(lua,job->rowcount);
+        }
+        lua_rawseti(lua,13,i+1);
+
+        /* rows are not needed any more */
+        if( job->rows != NULL ){
+            free(job->rows);
+            job->rows = NULL;
+        }
+    }
+    return 2;
+}
+
+/** olua_pool
  *
  * stack-in:
- *   (+1) connection.
- *   (+2) sql string
- *   (+3) bind values
+ *   (+1) { user=.. , password=.. [,db=..] [,min=N] [,max=N] [,incr=N] }
+ *        and options same as oluacle.new for the sessions.
  * stack-out
- *   (+1) iterator(fetch-function)
- *   (+2) statement-handle
+ *   (+1) pool-object
  */
-static int olua_exec(lua_State *lua)
+int olua_pool(lua_State *lua)
 {
-    int bindvars=lua_gettop(lua)-2;
+    struct olua_pool *pool;
+    OCIEnv *envhp=olua_envhp(lua);
+    const char *user, *passwd, *dbname;
+    ub4 min, max, incr;
+    sword status;
 
-    /* +1 connection
-     * +2 sql
-     * +3... binds
-     */
-    DEBUG( printf("stack=%d (before prepare)\n",lua_gettop(lua) ) );
+    luaL_checktype(lua,1,LUA_TTABLE);
+    lua_getfield(lua,1,"user");
+    lua_getfield(lua,1,"password");
+    lua_getfield(lua,1,"db");
+    user   = luaL_checkstring(lua,2);
+    passwd = luaL_checkstring(lua,3);
+    dbname = luaL_optstring(lua,4,"");
+    min  = (ub4)olua_optinteger(lua,1,"min",1);
+    max  = (ub4)olua_optinteger(lua,1,"max",4);
+    incr = (ub4)olua_optinteger(lua,1,"incr",1);
+    luaL_argcheck(lua,max >= 1 && min <= max,1,"invalid min/max");
 
-    olua_prepare(lua);
+    putenv("NLS_DATE_FORMAT=YYYY/MM/DD HH24:MI:SS");
 
-    /* +1 connection  => DEL
-     * +2 sql string  => DEL
-     *  : bind-values
-     * -1 statement-object
-     */
-    assert( lua_gettop(lua) == bindvars + 3 );
+    /* create instance */
+    lua_newtable(lua);
 
-    lua_remove(lua,+2); /* del: sql(original) */
-    lua_remove(lua,+1); /* del: connection(original) */
-    lua_insert(lua,+1); /* mov: statement-handle */
+    /* member: handle */
+    pool = lua_newuserdata(lua,sizeof(struct olua_pool));
+    pool->spoolhp = NULL;
+    pool->errhp = NULL;
+    pool->name = NULL;
+    pool->name_len = 0;
+    pool->max = max;
+    pool->gets = 0;
+    pool->wait_ns = 0;
+    if( luaL_newmetatable(lua,TNAME_POOL) ){
+        lua_pushcfunction(lua,olua_pool_close);
+        lua_setfield(lua,-2,"__gc");
+        lua_pushstring(lua,TNAME_POOL);
+        lua_setfield(lua,-2,"__metatable");
+    }
+    lua_setmetatable(lua,-2);
 
-    DEBUG( printf("stack=%d (before bind)\n",lua_gettop(lua) ) );
+    status = OCIHandleAlloc(envhp , (dvoid**)&pool->errhp , OCI_HTYPE_ERROR , 0 , NULL );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,NULL,status);
+    status = OCIHandleAlloc(envhp , (dvoid**)&pool->spoolhp , OCI_HTYPE_SPOOL , 0 , NULL );
+    if( status != OCI_SUCCESS )
+        return checkerr(lua,pool->errhp,status);
+
+    status = OCISessionPoolCreate( envhp , pool->errhp , pool->spoolhp ,
+                &pool->name , &pool->name_len ,
+                (CONST OraText*)dbname , (ub4)strlen(dbname) ,
+                min , max , incr ,
+                (OraText*)user   , (ub4)strlen(user) ,
+                (OraText*)passwd , (ub4)strlen(passwd) ,
+                OCI_SPC_HOMOGENEOUS );
+    if( status != OCI_SUCCESS ){
+        /* the garbage collector frees the handles */
+        OCIHandleFree( pool->spoolhp , OCI_HTYPE_SPOOL );
+        pool->spoolhp = NULL;
+        return checkerr(lua,pool->errhp,status);
+    }
+    lua_setfield(lua,-2,"handle");
 
-    /* +1 statement-handle
-     *  : binds
-     */
-    assert( lua_gettop(lua) == bindvars + 1 );
-    olua_bind_core(lua,bindvars);
-    if( lua_isnil(lua,-1) )
-        return 1;
-    lua_settop(lua,1);
+    /* member: options */
+    lua_pushvalue(lua,1);
+    lua_setfield(lua,-2,"options");
 
-    /* +1 statement-handle */
-    assert( lua_gettop(lua) == 1 );
+    /* method: acquire */
+    lua_pushcfunction(lua,olua_pool_acquire);
+    lua_setfield(lua,-2,"acquire");
 
-    return olua_execute(lua);
+    /* method: parallel */
+    lua_pushcfunction(lua,olua_pool_parallel);
+    lua_setfield(lua,-2,"parallel");
+
+    /* method: stats */
+    lua_pushcfunction(lua,olua_pool_stats);
+    lua_setfield(lua,-2,"stats");
+
+    /* method: close */
+    lua_pushcfunction(lua,olua_pool_close);
+    lua_setfield(lua,-2,"close");
+
+    return 1;
+}
+
+/* olua_resume
+ *   resume the coroutine. *nresults is set to the number of the values
+ *   yielded or returned on the top of its stack.
+ */
+static int olua_resume(lua_State *co,lua_State *from,int *nresults)
+{
+#if LUA_VERSION_NUM >= 504
+    return lua_resume(co,from,0,nresults);
+#else
+    int status=lua_resume(co,from,0);
+
+    *nresults = lua_gettop(co);
+    return status;
+#endif
+}
+
+/* lua-function: olua_run
+ *   run the functions as coroutines until all of them end. A coroutine
+ *   waiting for a non-blocking OCI call is resumed on the next round, and
+ *   the round sleeps a milli-second when all of them are waiting.
+ *  stack-in
+ *    (+1..) functions
+ *  return
+ *    the first return value of each function.
+ *    an error of a function is raised after all others end.
+ */
+int olua_run(lua_State *lua)
+{
+    int n=lua_gettop(lua);
+    int alive=n;
+    int failed=0;
+    int i;
+
+    luaL_checkstack(lua,n+2,"too many functions");
+    for( i=1 ; i <= n ; i++ ){
+        lua_State *co;
+
+        luaL_checktype(lua,i,LUA_TFUNCTION);
+        co = lua_newthread(lua);
+        lua_pushvalue(lua,i);
+        lua_xmove(lua,co,1);
+        lua_replace(lua,i);
+    }
+    /* stack: 1..n coroutines (false when ended) , n+1..2n results */
+    for( i=1 ; i <= n ; i++ )
+        lua_pushnil(lua);
+
+    while( alive > 0 ){
+        int running=0 , pending=0;
+
+        for( i=1 ; i <= n ; i++ ){
+            lua_State *co=lua_tothread(lua,i);
+            int status , nresults=0;
+
+            if( co == NULL )
+                continue;
+            status = olua_resume(co,lua,&nresults);
+            if( status == LUA_YIELD ){
+                running++;
+                if( nresults > 0 && lua_touserdata(co,-1) == &olua_pending )
+                    pending++;
+#if LUA_VERSION_NUM >= 504
+                /* the frame of the C function yielded stays below them
+                 * for its continuation */
+                lua_pop(co,nresults);
+#else
+                lua_settop(co,0);
+#endif
+                continue;
+            }
+            if( status == LUA_OK ){
+                if( lua_gettop(co) > 0 ){
+                    lua_settop(co,1);
+                    lua_xmove(co,lua,1);
+                    lua_replace(lua,n+i);
+                }
+            }else if( failed == 0 ){
+                failed = i;
+                lua_xmove(co,lua,1);
+                lua_replace(lua,n+i);
+            }
+            lua_pushboolean(lua,0);
+            lua_replace(lua,i);
+            alive--;
+        }
+        if( running > 0 && pending == running )
+            olua_sleep();
+    }
+    if( failed != 0 ){
+        lua_pushvalue(lua,n+failed);
+        return lua_error(lua);
+    }
+    return n;
 }
 
 int luaopen_oluacle(lua_State *lua)
@@ -1121,5 +6998,17 @@ int luaopen_oluacle(lua_State *lua)
     lua_newtable(lua);
     lua_pushcfunction(lua,olua_connect);
     lua_setfield(lua,-2,"new");
+    lua_pushcfunction(lua,olua_pool);
+    lua_setfield(lua,-2,"pool");
+    lua_pushcfunction(lua,olua_run);
+    lua_setfield(lua,-2,"run");
+    lua_pushcfunction(lua,olua_environ);
+    lua_setfield(lua,-2,"environ");
+    lua_pushcfunction(lua,olua_stats);
+    lua_setfield(lua,-2,"stats");
+    lua_pushcfunction(lua,olua_out);
+    lua_setfield(lua,-2,"out");
+    lua_pushcfunction(lua,olua_inout);
+    lua_setfield(lua,-2,"inout");
     return 1;
 }